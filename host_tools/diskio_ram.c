@@ -0,0 +1,142 @@
+#include "diskio_ram.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+// Backend do diskio para o PC: drive 0 num buffer em RAM ou num arquivo de
+// imagem de disco do Linux, com latência de cartão SD simulada
+
+#define RAM_SECTOR_SIZE 512
+
+static uint8_t *mem = NULL;       // Disco em RAM (modo memória)
+static int image_fd = -1;         // Arquivo de imagem (modo imagem)
+static uint32_t sector_count = 0;
+static ram_disk_latency_t latency;
+static ram_disk_stats_t stats;
+
+
+static void simulate(uint64_t us) {
+    stats.sim_us += us;
+    if (latency.realtime && us) {
+        struct timespec ts = { (time_t)(us / 1000000u), (long)(us % 1000000u) * 1000 };
+        nanosleep(&ts, NULL);
+    }
+}
+
+bool ram_disk_open_memory(uint32_t sectors) {
+    ram_disk_close();
+    mem = calloc(sectors, RAM_SECTOR_SIZE);
+    if (!mem) return false;
+    sector_count = sectors;
+    return true;
+}
+
+// Abre (ou cria com sectors_if_new setores) um arquivo de imagem
+bool ram_disk_open_image(const char *path, uint32_t sectors_if_new) {
+    ram_disk_close();
+    image_fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (image_fd < 0) return false;
+
+    struct stat st;
+    if (fstat(image_fd, &st) != 0) {
+        ram_disk_close();
+        return false;
+    }
+    if (st.st_size == 0) {
+        if (ftruncate(image_fd, (off_t)sectors_if_new * RAM_SECTOR_SIZE) != 0) {
+            ram_disk_close();
+            return false;
+        }
+        st.st_size = (off_t)sectors_if_new * RAM_SECTOR_SIZE;
+    }
+    sector_count = (uint32_t)(st.st_size / RAM_SECTOR_SIZE);
+    return true;
+}
+
+void ram_disk_close(void) {
+    free(mem);
+    mem = NULL;
+    if (image_fd >= 0) close(image_fd);
+    image_fd = -1;
+    sector_count = 0;
+}
+
+void ram_disk_set_latency(const ram_disk_latency_t *new_latency) {
+    latency = *new_latency;
+}
+
+void ram_disk_get_stats(ram_disk_stats_t *out) {
+    *out = stats;
+}
+
+void ram_disk_reset_stats(void) {
+    memset(&stats, 0, sizeof(stats));
+}
+
+
+static DSTATUS ram_initialize(void) {
+    return sector_count ? 0 : STA_NODISK;
+}
+
+static DRESULT ram_read(BYTE *buff, LBA_t sector, UINT count) {
+    if (sector + count > sector_count) return RES_PARERR;
+
+    stats.read_cmds++;
+    stats.sectors_read += count;
+    // Como o sd_spi.c: CMD17 para um setor; CMD18 + CMD12 para vários
+    simulate((count > 1 ? 2u * latency.cmd_us : latency.cmd_us) + (uint64_t)count * latency.sector_us);
+
+    size_t len = (size_t)count * RAM_SECTOR_SIZE;
+    if (mem) {
+        memcpy(buff, mem + (size_t)sector * RAM_SECTOR_SIZE, len);
+        return RES_OK;
+    }
+    return pread(image_fd, buff, len, (off_t)sector * RAM_SECTOR_SIZE) == (ssize_t)len ? RES_OK : RES_ERROR;
+}
+
+static DRESULT ram_write(const BYTE *buff, LBA_t sector, UINT count) {
+    if (sector + count > sector_count) return RES_PARERR;
+
+    stats.write_cmds++;
+    stats.sectors_written += count;
+    simulate((uint64_t)count * (latency.cmd_us + latency.sector_us + latency.write_busy_us));
+
+    size_t len = (size_t)count * RAM_SECTOR_SIZE;
+    if (mem) {
+        memcpy(mem + (size_t)sector * RAM_SECTOR_SIZE, buff, len);
+        return RES_OK;
+    }
+    return pwrite(image_fd, buff, len, (off_t)sector * RAM_SECTOR_SIZE) == (ssize_t)len ? RES_OK : RES_ERROR;
+}
+
+static DRESULT ram_sync(void) {
+    stats.syncs++; // sem fsync na imagem: o custo do cartão é o simulado
+    return RES_OK;
+}
+
+static DRESULT ram_ioctl(BYTE cmd, void *buff) {
+    switch (cmd) {
+    case GET_SECTOR_SIZE:
+        *(WORD *)buff = RAM_SECTOR_SIZE;
+        return RES_OK;
+    case GET_BLOCK_SIZE:
+        *(DWORD *)buff = 8192; // AU de 4 MiB, típica de cartões SDHC
+        return RES_OK;
+    case GET_SECTOR_COUNT:
+        *(LBA_t *)buff = sector_count;
+        return RES_OK;
+    }
+    return RES_PARERR;
+}
+
+const disk_backend_t ram_disk_backend = {
+    .initialize = ram_initialize,
+    .read = ram_read,
+    .write = ram_write,
+    .sync = ram_sync,
+    .ioctl = ram_ioctl,
+};
@@ -0,0 +1,45 @@
+#ifndef DISKIO_RAM_H
+#define DISKIO_RAM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "ff.h"
+#include "diskio.h"
+#include "sd_diskio.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Latências simuladas por comando (aproximam um cartão SD em SPI).
+// São somadas em ram_disk_stats_t.sim_us; com realtime = true também dormem.
+typedef struct {
+    uint32_t cmd_us;          // Custo fixo de cada comando (CMD17/CMD24, resposta, token)
+    uint32_t sector_us;       // Transferência de 512 bytes
+    uint32_t write_busy_us;   // Programação após cada setor escrito
+    bool realtime;            // Dormir as latências de verdade
+} ram_disk_latency_t;
+
+typedef struct {
+    uint64_t read_cmds;       // Chamadas de leitura ao meio
+    uint64_t write_cmds;      // Chamadas de escrita ao meio
+    uint64_t sectors_read;
+    uint64_t sectors_written;
+    uint64_t syncs;
+    uint64_t sim_us;          // Tempo simulado acumulado
+} ram_disk_stats_t;
+
+extern const disk_backend_t ram_disk_backend;
+
+extern bool ram_disk_open_memory(uint32_t sectors);
+extern bool ram_disk_open_image(const char *path, uint32_t sectors_if_new);
+extern void ram_disk_close(void);
+extern void ram_disk_set_latency(const ram_disk_latency_t *latency);
+extern void ram_disk_get_stats(ram_disk_stats_t *stats);
+extern void ram_disk_reset_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,239 @@
+// Testes do tokenizador NMEA (nmea.c) e das conversões de campos usadas pelo
+// driver do GPS: checksum certo e errado, sentenças truncadas e grandes
+// demais, campos vazios e arredondamento de coordenadas até ±180°.
+//
+// Uso: nmea_test (código de saída 0 se todos os casos passarem)
+
+#include "nmea.h"
+
+#include <cstdio>
+#include <string>
+
+namespace {
+
+int failures = 0;
+
+#define CHECK(cond)                                                        \
+    do {                                                                   \
+        if (!(cond)) {                                                     \
+            std::fprintf(stderr, "%s:%d: falhou: %s\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                    \
+        }                                                                  \
+    } while (0)
+
+// "$corpo*hh\r\n" com o checksum calculado
+std::string sentence(const std::string &body) {
+    unsigned sum = 0;
+    for (char c : body) sum ^= (unsigned char)c;
+    char tail[8];
+    std::snprintf(tail, sizeof(tail), "*%02X\r\n", sum);
+    return "$" + body + tail;
+}
+
+// Alimenta o texto todo; devolve a última sentença entregue (ou nullptr)
+const nmea_sentence_t *feed(nmea_parser_t *p, const std::string &text, int *delivered = nullptr) {
+    const nmea_sentence_t *last = nullptr;
+    int n = 0;
+    for (char c : text) {
+        if (const nmea_sentence_t *s = nmea_feed(p, c)) {
+            last = s;
+            n++;
+        }
+    }
+    if (delivered) *delivered = n;
+    return last;
+}
+
+void test_checksum() {
+    nmea_parser_t p;
+    nmea_init(&p);
+
+    // Exemplo clássico da norma, checksum 6A
+    const nmea_sentence_t *s =
+        feed(&p, "$GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W*6A\r\n");
+    CHECK(s != nullptr);
+    if (s) {
+        CHECK(s->count == 12);
+        CHECK(std::string(nmea_field(s, 0)) == "GPRMC");
+        CHECK(std::string(nmea_field(s, 3)) == "4807.038");
+        CHECK(std::string(nmea_field(s, 11)) == "W");
+        CHECK(std::string(nmea_field(s, 12)).empty()); // além do último campo
+    }
+
+    // Dígitos hexadecimais minúsculos também valem
+    CHECK(feed(&p, "$GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W*6a\r\n") != nullptr);
+
+    // Um dígito errado (o primeiro ou o segundo) descarta a sentença
+    CHECK(feed(&p, "$GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W*7A\r\n") == nullptr);
+    CHECK(feed(&p, "$GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W*6B\r\n") == nullptr);
+    // Corpo corrompido com o checksum original
+    CHECK(feed(&p, "$GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,E*6A\r\n") == nullptr);
+
+    CHECK(p.stats.sentences == 2);
+    CHECK(p.stats.checksum_errors == 3);
+    CHECK(p.stats.truncated == 0);
+}
+
+void test_truncated() {
+    nmea_parser_t p;
+    nmea_init(&p);
+
+    // Fim de linha antes do '*', com um só dígito e com lixo no lugar do dígito
+    CHECK(feed(&p, "$GPGGA,123519,4807.038,N\r\n") == nullptr);
+    std::string zda = sentence("GPZDA,123519,23,03,1994,,");
+    CHECK(feed(&p, zda.substr(0, zda.find('*') + 2) + "\r\n") == nullptr);
+    CHECK(feed(&p, "$GPVTG,,T,,M,0.1,N,0.2,K*G0\r\n") == nullptr);
+    CHECK(p.stats.truncated == 3);
+
+    // '$' no meio (bytes perdidos na UART) reinicia na sentença seguinte
+    int n = 0;
+    const nmea_sentence_t *s = feed(&p, "$GPGSA,A,3,0" + sentence("GPVTG,,T,,M,0.1,N,0.2,K"), &n);
+    CHECK(n == 1);
+    CHECK(s && std::string(nmea_field(s, 0)) == "GPVTG");
+    CHECK(p.stats.truncated == 4);
+
+    // Checksum certo, mas algo além do fim de linha antes do '\n'
+    std::string bad = sentence("GPVTG,,T,,M,0.1,N,0.2,K");
+    bad.insert(bad.size() - 2, "X");
+    CHECK(feed(&p, bad) == nullptr);
+    CHECK(p.stats.truncated == 5);
+
+    // Bytes antes do primeiro '$' são ignorados sem contar erro
+    CHECK(feed(&p, "lixo\r\n" + sentence("GPVTG,,T,,M,0.1,N,0.2,K")) != nullptr);
+    CHECK(p.stats.truncated == 5);
+}
+
+void test_oversize() {
+    nmea_parser_t p;
+    nmea_init(&p);
+
+    // Maior corpo aceito: NMEA_MAX_LEN - 1 bytes (o '\0' final precisa caber)
+    std::string body = "GPTXT," + std::string(NMEA_MAX_LEN - 1 - 6, 'A');
+    CHECK(feed(&p, sentence(body)) != nullptr);
+    CHECK(feed(&p, sentence(body + "A")) == nullptr);
+    CHECK(p.stats.overflows == 1);
+
+    // Campos demais
+    std::string fields = "GPGSV";
+    for (int i = 1; i < NMEA_MAX_FIELDS; i++) fields += ",";
+    const nmea_sentence_t *s = feed(&p, sentence(fields));
+    CHECK(s && s->count == NMEA_MAX_FIELDS);
+    CHECK(feed(&p, sentence(fields + ",")) == nullptr);
+    CHECK(p.stats.overflows == 2);
+
+    // O parser volta ao normal depois do descarte
+    CHECK(feed(&p, sentence("GPVTG,,T,,M,0.1,N,0.2,K")) != nullptr);
+}
+
+void test_empty_fields() {
+    nmea_parser_t p;
+    nmea_init(&p);
+
+    // RMC antes do fix: campos vazios continuam ocupando o seu índice
+    const nmea_sentence_t *s = feed(&p, sentence("GPRMC,,V,,,,,,,,,,N"));
+    CHECK(s != nullptr);
+    if (!s) return;
+    CHECK(s->count == 13);
+    CHECK(std::string(nmea_field(s, 2)) == "V");
+    CHECK(std::string(nmea_field(s, 12)) == "N");
+    for (int i : {1, 3, 4, 5, 6, 9, 11}) CHECK(nmea_field(s, (uint8_t)i)[0] == '\0');
+
+    int32_t v = 123;
+    utc_time_t utc{};
+    CHECK(!nmea_to_e7(nmea_field(s, 3), nmea_field(s, 4)[0], 90, &v));
+    CHECK(!nmea_to_fixed(nmea_field(s, 7), 2, &v));
+    CHECK(!nmea_time(nmea_field(s, 1), &utc));
+    CHECK(!nmea_date(nmea_field(s, 9), &utc));
+    CHECK(v == 123); // saída intocada na falha
+}
+
+void test_coordinates() {
+    int32_t v = 0;
+
+    CHECK(nmea_to_e7("4807.038", 'N', 90, &v) && v == 481173000);
+    CHECK(nmea_to_e7("01131.000", 'E', 180, &v) && v == 115166667); // 11,51666...° arredondado
+    CHECK(nmea_to_e7("2254.12345", 'S', 90, &v) && v == -229020575);
+
+    // Arredondamento no último dígito: 0,5e-7° sobe, abaixo disso desce
+    CHECK(nmea_to_e7("00000.000003", 'E', 180, &v) && v == 1);
+    CHECK(nmea_to_e7("00000.0000029", 'E', 180, &v) && v == 0);
+    CHECK(nmea_to_e7("00000.00001", 'W', 180, &v) && v == -2);
+
+    // ±180°: o limite vale, o arredondamento pode chegar nele, mas não passar
+    CHECK(nmea_to_e7("18000.00000", 'E', 180, &v) && v == 1800000000);
+    CHECK(nmea_to_e7("18000.00000", 'W', 180, &v) && v == -1800000000);
+    CHECK(nmea_to_e7("17959.9999999", 'E', 180, &v) && v == 1800000000);
+    CHECK(nmea_to_e7("17959.9999999", 'W', 180, &v) && v == -1800000000);
+    CHECK(nmea_to_e7("17959.99999", 'W', 180, &v) && v == -1799999998);
+    CHECK(!nmea_to_e7("18000.00001", 'E', 180, &v));
+    CHECK(!nmea_to_e7("18100.0", 'E', 180, &v));
+    CHECK(nmea_to_e7("9000.0", 'S', 90, &v) && v == -900000000);
+    CHECK(!nmea_to_e7("9000.01", 'N', 90, &v));
+
+    // Campos malformados
+    CHECK(!nmea_to_e7("4860.000", 'N', 90, &v));   // 60 minutos
+    CHECK(!nmea_to_e7("48", 'N', 90, &v));         // sem minutos
+    CHECK(!nmea_to_e7("123456.0", 'E', 180, &v));  // dígitos demais
+    CHECK(!nmea_to_e7("48O7.038", 'N', 90, &v));   // letra no lugar de dígito
+    CHECK(!nmea_to_e7("4807.03 ", 'N', 90, &v));
+    CHECK(!nmea_to_e7("4807.038", 'X', 90, &v));
+    CHECK(!nmea_to_e7("4807.038", '\0', 90, &v));
+}
+
+void test_fixed() {
+    int32_t v = 0;
+    CHECK(nmea_to_fixed("1.25", 2, &v) && v == 125);
+    CHECK(nmea_to_fixed("1.2", 2, &v) && v == 120);
+    CHECK(nmea_to_fixed("1.259", 2, &v) && v == 125); // casas extras são truncadas
+    CHECK(nmea_to_fixed("12", 1, &v) && v == 120);
+    CHECK(nmea_to_fixed("7.", 1, &v) && v == 70);
+    CHECK(nmea_to_fixed("-3.5", 1, &v) && v == -35);
+    CHECK(nmea_to_fixed("545.4", 1, &v) && v == 5454);
+    CHECK(!nmea_to_fixed("", 2, &v));
+    CHECK(!nmea_to_fixed("-", 2, &v));
+    CHECK(!nmea_to_fixed(".5", 2, &v));
+    CHECK(!nmea_to_fixed("1.2x", 2, &v));
+    CHECK(!nmea_to_fixed("99999999", 2, &v)); // estouraria o int32 escalado
+}
+
+void test_time() {
+    utc_time_t utc{};
+    CHECK(nmea_time("123519", &utc) && utc.hour == 12 && utc.min == 35 && utc.sec == 19);
+    CHECK(nmea_time("235960.00", &utc) && utc.sec == 60); // segundo intercalar
+    CHECK(nmea_time("000000.", &utc));
+
+    CHECK(!nmea_time("", &utc));
+    CHECK(!nmea_time("1235", &utc));
+    CHECK(!nmea_time("240000", &utc));
+    CHECK(!nmea_time("126000", &utc));
+    CHECK(!nmea_time("12a519", &utc));
+    CHECK(!nmea_time(" 23519", &utc));
+    CHECK(!nmea_time("1-3519", &utc));
+    CHECK(!nmea_time("12:35:19", &utc));
+    CHECK(!nmea_time("123519.0x", &utc));
+    CHECK(!nmea_time("1235190", &utc));
+
+    CHECK(nmea_date("230325", &utc) && utc.day == 23 && utc.month == 3 && utc.year == 2025);
+    CHECK(!nmea_date("2303a5", &utc));
+    CHECK(!nmea_date("23032", &utc));
+    CHECK(!nmea_date("2303250", &utc));
+}
+
+} // namespace
+
+int main() {
+    test_checksum();
+    test_truncated();
+    test_oversize();
+    test_empty_fields();
+    test_coordinates();
+    test_fixed();
+    test_time();
+
+    if (failures) {
+        std::fprintf(stderr, "%d verificação(ões) falharam\n", failures);
+        return 1;
+    }
+    std::printf("nmea_test: ok\n");
+    return 0;
+}
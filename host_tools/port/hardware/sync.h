@@ -0,0 +1,10 @@
+#ifndef HOST_PORT_HARDWARE_SYNC_H
+#define HOST_PORT_HARDWARE_SYNC_H
+
+// Substituto do hardware/sync.h: barreira de memória do compilador/CPU do PC
+
+static inline void __dmb(void) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef HOST_PORT_PICO_MULTICORE_H
+#define HOST_PORT_PICO_MULTICORE_H
+
+// Substituto do pico/multicore.h: o "core1" é uma thread (pilha própria ignorada)
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+static void *host_core1_trampoline(void *entry) {
+    ((void (*)(void))entry)();
+    return NULL;
+}
+
+static inline void multicore_launch_core1_with_stack(void (*entry)(void), uint32_t *stack_bottom, size_t stack_size_bytes) {
+    (void)stack_bottom;
+    (void)stack_size_bytes;
+    pthread_t thread;
+    pthread_create(&thread, NULL, host_core1_trampoline, (void *)entry);
+    pthread_detach(thread);
+}
+
+#endif
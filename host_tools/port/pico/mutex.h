@@ -0,0 +1,63 @@
+#ifndef HOST_PORT_PICO_MUTEX_H
+#define HOST_PORT_PICO_MUTEX_H
+
+// Substituto do pico/mutex.h sobre pthreads para compilar no PC o logger e o
+// ffsystem.c (FatFs reentrante). Só o subconjunto usado pelo firmware.
+// Requer _GNU_SOURCE (PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP), definido no CMake.
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+typedef struct { pthread_mutex_t m; } mutex_t;
+typedef struct { pthread_mutex_t m; } recursive_mutex_t;
+
+#define auto_init_mutex(name) static mutex_t name = { PTHREAD_MUTEX_INITIALIZER }
+#define auto_init_recursive_mutex(name) static recursive_mutex_t name = { PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP }
+
+static inline void mutex_init(mutex_t *mtx) {
+    pthread_mutex_init(&mtx->m, NULL);
+}
+
+static inline void mutex_enter_blocking(mutex_t *mtx) {
+    pthread_mutex_lock(&mtx->m);
+}
+
+static inline bool mutex_enter_timeout_ms(mutex_t *mtx, uint32_t timeout_ms) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec += timeout_ms / 1000u;
+    ts.tv_nsec += (long)(timeout_ms % 1000u) * 1000000L;
+    if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+    return pthread_mutex_timedlock(&mtx->m, &ts) == 0;
+}
+
+static inline void mutex_exit(mutex_t *mtx) {
+    pthread_mutex_unlock(&mtx->m);
+}
+
+static inline void recursive_mutex_init(recursive_mutex_t *mtx) {
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&mtx->m, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+static inline bool recursive_mutex_enter_timeout_ms(recursive_mutex_t *mtx, uint32_t timeout_ms) {
+    return mutex_enter_timeout_ms((mutex_t *)mtx, timeout_ms);
+}
+
+static inline void recursive_mutex_enter_blocking(recursive_mutex_t *mtx) {
+    pthread_mutex_lock(&mtx->m);
+}
+
+static inline void recursive_mutex_exit(recursive_mutex_t *mtx) {
+    pthread_mutex_unlock(&mtx->m);
+}
+
+#endif
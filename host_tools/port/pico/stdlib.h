@@ -0,0 +1,32 @@
+#ifndef HOST_PORT_PICO_STDLIB_H
+#define HOST_PORT_PICO_STDLIB_H
+
+// Substituto mínimo do pico/stdlib.h para compilar no PC os módulos do
+// firmware que só usam o timer (sd_logger.c, time_service.c, log_service.c)
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+typedef uint64_t absolute_time_t;
+
+static inline uint64_t time_us_64(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+static inline absolute_time_t get_absolute_time(void) {
+    return time_us_64();
+}
+
+static inline void sleep_us(uint64_t us) {
+    struct timespec ts = { (time_t)(us / 1000000u), (long)(us % 1000000u) * 1000L };
+    nanosleep(&ts, NULL);
+}
+
+static inline uint32_t to_ms_since_boot(absolute_time_t t) {
+    return (uint32_t)(t / 1000u);
+}
+
+#endif
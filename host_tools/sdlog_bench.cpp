@@ -0,0 +1,465 @@
+// Benchmark do caminho de log no SD sobre o backend em RAM/imagem do diskio.
+//
+// Uso: sdlog_bench [-n registros] [-i imagem.img] [--realtime]
+//      (sdlog_bench_exfat: o mesmo com o perfil exFAT/LFN do ffconf.h)
+//
+// Cada cenário formata um volume novo, grava n registros de 16 bytes
+// (log_record_t) e mede: registros/s (tempo de CPU + latência simulada do
+// cartão), setores lidos e escritos por registro, amplificação de escrita
+// (bytes gravados no meio / bytes de registro) e acerto do cache do diskio.
+// No fim, mede a compressão (log_codec) isolada: razão e custo por registro.
+
+#include "diskio_ram.h"
+#include "log_codec.h"
+#include "log_record.h"
+#include "log_service.h"
+#include "sd_logger.h"
+#include "time_service.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+extern "C" DWORD get_fattime(void) {
+    return time_service_fattime();
+}
+
+namespace {
+
+constexpr uint32_t kDiskSectors = 512u * 1024u * 1024u / 512u; // 512 MiB: FAT32 com clusters de 4 KiB
+#if FF_FS_EXFAT
+constexpr BYTE kFsFormat = FM_EXFAT;
+constexpr UINT kAuBytes = 128 * 1024; // Clusters de cartões SDXC formatados de fábrica
+#else
+constexpr BYTE kFsFormat = FM_FAT32;
+constexpr UINT kAuBytes = 4096;
+#endif
+
+struct options {
+    uint32_t records = 20000;
+    std::string image;
+    bool realtime = false;
+    uint32_t rate = 4000;       // Registros/s do produtor no cenário do serviço (core0)
+    uint32_t drop_budget = 0;   // Descartes aceitos nesse cenário antes de falhar
+};
+
+struct result {
+    const char *name;
+    uint32_t records;
+    double cpu_s;
+    ram_disk_stats_t io;
+    disk_cache_stats_t cache;
+};
+
+bool format_volume(const options &opt) {
+    bool ok = opt.image.empty() ? ram_disk_open_memory(kDiskSectors)
+                                : ram_disk_open_image(opt.image.c_str(), kDiskSectors);
+    if (!ok) return false;
+
+    static BYTE work[FF_MAX_SS * 8];
+    MKFS_PARM parm = { kFsFormat, 0, 0, 0, kAuBytes };
+    FRESULT fr = f_mkfs("", &parm, work, sizeof(work));
+    if (fr != FR_OK) std::fprintf(stderr, "f_mkfs: erro %d\n", fr);
+    return fr == FR_OK;
+}
+
+void make_record(log_record_t *rec, uint32_t i) {
+    // Trajetória sintética: só os últimos dígitos mudam, como num GPS parado
+    log_record_make(rec, LOG_REC_GPS_POS, i * 1000u, -231234567 + (int32_t)(i % 97), -465000001 - (int32_t)(i % 89));
+}
+
+// prepare roda depois da formatação e fora da medição (ex.: gravar o log a ser lido)
+template <typename Fn, typename Prep>
+result run(const char *name, const options &opt, Fn &&body, Prep &&prepare) {
+    result r{};
+    r.name = name;
+    r.records = opt.records;
+    if (!format_volume(opt)) {
+        std::fprintf(stderr, "%s: falha ao formatar o volume\n", name);
+        std::exit(1);
+    }
+
+    if (!prepare()) {
+        std::fprintf(stderr, "%s: erro de E/S na preparação\n", name);
+        std::exit(1);
+    }
+    ram_disk_reset_stats();
+    disk_cache_reset_stats();
+    auto t0 = std::chrono::steady_clock::now();
+    if (!body()) {
+        std::fprintf(stderr, "%s: erro de E/S\n", name);
+        std::exit(1);
+    }
+    r.cpu_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    ram_disk_get_stats(&r.io);
+    disk_cache_get_stats(&r.cache);
+    return r;
+}
+
+template <typename Fn>
+result run(const char *name, const options &opt, Fn &&body) {
+    return run(name, opt, body, [] { return true; });
+}
+
+// Caminho antigo do sd_card.c: monta, abre, posiciona, grava e fecha por registro
+bool legacy_appends(uint32_t n) {
+    static FATFS fs;
+    static FIL fil;
+    for (uint32_t i = 0; i < n; i++) {
+        log_record_t rec;
+        make_record(&rec, i);
+        UINT bw;
+        if (f_mount(&fs, "", 1) != FR_OK) return false;
+        if (f_open(&fil, "LOCALI.BIN", FA_WRITE | FA_OPEN_ALWAYS) != FR_OK) return false;
+        if (f_lseek(&fil, f_size(&fil)) != FR_OK) return false;
+        if (f_write(&fil, &rec, sizeof(rec), &bw) != FR_OK || bw != sizeof(rec)) return false;
+        if (f_close(&fil) != FR_OK) return false;
+    }
+    f_unmount("");
+    return true;
+}
+
+bool session_appends(log_t *log, uint32_t n, bool event) {
+    for (uint32_t i = 0; i < n; i++) {
+        log_record_t rec;
+        make_record(&rec, i);
+        if (log_append(log, &rec, sizeof(rec), event) != FR_OK) return false;
+    }
+    return true;
+}
+
+// Leitor concorrente (como um exportador no core0): reabre o arquivo com um FIL
+// próprio e confere o CRC de cada registro já sincronizado pelo logger
+bool reader_loop(const std::atomic<bool> &done, uint32_t *passes) {
+    static FIL fil; // só esta thread usa
+    log_record_t records[8];
+    UINT br;
+    while (!done.load()) {
+        if (f_open(&fil, "LOCALI.BIN", FA_READ) != FR_OK) return false;
+        do {
+            if (f_read(&fil, records, sizeof(records), &br) != FR_OK) return false;
+            for (UINT i = 0; i < br / sizeof(log_record_t); i++) {
+                if (!log_record_valid(&records[i])) return false;
+            }
+        } while (br == sizeof(records));
+        f_close(&fil);
+        (*passes)++;
+    }
+    return true;
+}
+
+// Exportação completa como o read_from_sd: f_read em pedaços menores que um
+// setor, então o FatFs pede ao diskio um setor por vez
+bool dump_file(uint32_t expected) {
+    static FATFS fs;
+    static FIL fil;
+    uint8_t chunk[127];
+    uint8_t pending[sizeof(log_record_t)];
+    UINT br, have = 0;
+    uint32_t n = 0;
+    if (f_mount(&fs, "", 1) != FR_OK) return false;
+    if (f_open(&fil, "LOCALI.BIN", FA_READ) != FR_OK) return false;
+    do {
+        if (f_read(&fil, chunk, sizeof(chunk), &br) != FR_OK) return false;
+        for (UINT i = 0; i < br; i++) {
+            pending[have++] = chunk[i];
+            if (have < sizeof(pending)) continue;
+            log_record_t rec;
+            std::memcpy(&rec, pending, sizeof(rec));
+            if (!log_record_valid(&rec)) return false;
+            have = 0;
+            n++;
+        }
+    } while (br == sizeof(chunk));
+    f_close(&fil);
+    f_unmount("");
+    return n == expected;
+}
+
+// Log com hora: sincronização no início e um registro por segundo (make_record)
+const uint32_t kBaseUnix = 1760000000u;
+
+bool timed_session(log_t *log, const log_policy_t *policy, uint32_t n, bool keep_index) {
+    if (log_open(log, "LOCALI.BIN", policy) != FR_OK) return false;
+    log_record_t sync;
+    log_record_make(&sync, LOG_REC_TIME_SYNC, 0, (int32_t)kBaseUnix, 0);
+    bool ok = log_append(log, &sync, sizeof(sync), false) == FR_OK && session_appends(log, n, false);
+    ok = log_close(log) == FR_OK && ok;
+    if (keep_index) return ok;
+    static FATFS fs; // apaga o índice: a consulta varre o arquivo inteiro
+    ok = ok && f_mount(&fs, "", 1) == FR_OK && f_unlink("LOCALI.IDX") == FR_OK;
+    f_unmount("");
+    return ok;
+}
+
+// Consulta de uma hora no meio do log; confere se vieram exatamente os 3600 registros
+bool query_hour(log_t *log, const log_policy_t *policy, uint32_t n, uint32_t *found) {
+    uint32_t from = kBaseUnix + n / 2, to = from + 3599;
+    struct window {
+        uint32_t from, count;
+        bool ok;
+    } w{ from, 0, true };
+    auto emit = [](const log_record_t *rec, uint32_t unix_s, void *ctx) {
+        auto *w = static_cast<window *>(ctx);
+        if (rec->type != LOG_REC_GPS_POS || rec->t_ms != (unix_s - kBaseUnix) * 1000u ||
+            unix_s != w->from + w->count) w->ok = false;
+        w->count++;
+    };
+    if (log_open(log, "LOCALI.BIN", policy) != FR_OK) return false;
+    bool ok = log_query_time(log, from, to, emit, &w) == FR_OK;
+    ok = log_close(log) == FR_OK && ok;
+    *found = w.count;
+    return ok && w.ok && w.count == (n / 2 + 3600 <= n ? 3600u : n - n / 2);
+}
+
+// Sink do serviço de log (roda na thread que faz o papel do core1)
+log_t service_log;
+FRESULT service_sink(const log_record_t *rec, bool event) {
+    return log_append(&service_log, rec, sizeof(*rec), event);
+}
+
+const log_policy_t kPeriodic = { 5000, 4096, false, false }; // pratica03 sem compressão
+const log_policy_t kPerEvent = { 5000, 4096, true, false };  // pratica05
+const log_policy_t kOddSync = { 0, 1000, false, false };     // f_sync fora de fronteira de setor
+const log_policy_t kCompressed = { 5000, 4096, false, true }; // pratica03
+
+// Compressão isolada: codifica n registros em quadros, decodifica e confere
+struct codec_result {
+    uint32_t frames;
+    double encode_us; // por registro
+    double decode_us; // por registro
+    bool ok;
+};
+
+codec_result codec_roundtrip(uint32_t n) {
+    std::vector<uint8_t> frames;
+    static uint8_t frame[LOG_CODEC_FRAME_SIZE];
+    static log_codec_t codec;
+    codec_result r{};
+
+    auto t0 = std::chrono::steady_clock::now();
+    log_codec_begin(&codec, frame);
+    for (uint32_t i = 0; i < n; i++) {
+        log_record_t rec;
+        make_record(&rec, i);
+        if (!log_codec_put(&codec, &rec)) {
+            log_codec_finish(&codec);
+            frames.insert(frames.end(), frame, frame + LOG_CODEC_FRAME_SIZE);
+            log_codec_begin(&codec, frame);
+            log_codec_put(&codec, &rec);
+        }
+    }
+    log_codec_finish(&codec);
+    frames.insert(frames.end(), frame, frame + LOG_CODEC_FRAME_SIZE);
+    auto t1 = std::chrono::steady_clock::now();
+
+    struct check {
+        uint32_t next = 0;
+        bool ok = true;
+    } chk;
+    auto emit = [](const log_record_t *rec, void *p) {
+        auto *c = static_cast<check *>(p);
+        log_record_t want;
+        make_record(&want, c->next++);
+        if (std::memcmp(&want, rec, sizeof(want)) != 0) c->ok = false;
+    };
+    for (size_t off = 0; off < frames.size(); off += LOG_CODEC_FRAME_SIZE) {
+        if (log_codec_decode(&frames[off], emit, &chk) < 0) chk.ok = false;
+    }
+    auto t2 = std::chrono::steady_clock::now();
+
+    r.frames = (uint32_t)(frames.size() / LOG_CODEC_FRAME_SIZE);
+    r.encode_us = std::chrono::duration<double, std::micro>(t1 - t0).count() / n;
+    r.decode_us = std::chrono::duration<double, std::micro>(t2 - t1).count() / n;
+    r.ok = chk.ok && chk.next == n;
+    return r;
+}
+
+void print_result(const result &r) {
+    double total_s = r.cpu_s + (double)r.io.sim_us / 1e6;
+    double payload = (double)r.records * LOG_REC_SIZE;
+    uint32_t hits = r.cache.read_hits + r.cache.readahead_hits + r.cache.write_hits;
+    uint32_t accesses = hits + r.cache.read_misses + r.cache.write_misses;
+    std::printf("%-22s %9.0f %10.2f %10.2f %9.2f %9.1f%%\n",
+                r.name,
+                r.records / total_s,
+                (double)r.io.sectors_read / r.records,
+                (double)r.io.sectors_written / r.records,
+                (double)r.io.sectors_written * 512.0 / payload,
+                accesses ? 100.0 * hits / accesses : 0.0);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    options opt;
+    for (int i = 1; i < argc; i++) {
+        if (!std::strcmp(argv[i], "-n") && i + 1 < argc) {
+            opt.records = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+        } else if (!std::strcmp(argv[i], "-i") && i + 1 < argc) {
+            opt.image = argv[++i];
+        } else if (!std::strcmp(argv[i], "--realtime")) {
+            opt.realtime = true;
+        } else if (!std::strcmp(argv[i], "--rate") && i + 1 < argc) {
+            opt.rate = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+        } else if (!std::strcmp(argv[i], "--drop-budget") && i + 1 < argc) {
+            opt.drop_budget = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+        } else {
+            std::fprintf(stderr, "uso: %s [-n registros] [-i imagem.img] [--realtime] [--rate reg/s] [--drop-budget n]\n",
+                         argv[0]);
+            return 2;
+        }
+    }
+    if (opt.records == 0) opt.records = 1;
+    if (opt.rate == 0) opt.rate = 1;
+
+    // SPI a ~12 MHz: ~350 us por setor, ~100 us por comando, ~300 us de programação
+    ram_disk_latency_t lat = { 100, 350, 300, opt.realtime };
+    ram_disk_set_latency(&lat);
+    disk_set_backend(&ram_disk_backend);
+
+    std::vector<result> results;
+    static log_t log;
+
+    results.push_back(run("abre/fecha por registro", opt, [&] {
+        return legacy_appends(opt.records);
+    }));
+    results.push_back(run("sessao (5 s / 4 KiB)", opt, [&] {
+        if (log_open(&log, "LOCALI.BIN", &kPeriodic) != FR_OK) return false;
+        bool ok = session_appends(&log, opt.records, false);
+        return log_close(&log) == FR_OK && ok;
+    }));
+    results.push_back(run("sessao (sync 1000 B)", opt, [&] {
+        if (log_open(&log, "LOCALI.BIN", &kOddSync) != FR_OK) return false;
+        bool ok = session_appends(&log, opt.records, false);
+        return log_close(&log) == FR_OK && ok;
+    }));
+    results.push_back(run("sessao (sync/evento)", opt, [&] {
+        if (log_open(&log, "DISTA.BIN", &kPerEvent) != FR_OK) return false;
+        bool ok = session_appends(&log, opt.records, true);
+        return log_close(&log) == FR_OK && ok;
+    }));
+    results.push_back(run("contiguo (f_expand)", opt, [&] {
+        if (log_open_contiguous(&log, "IMU.BIN", &kPeriodic, (FSIZE_t)opt.records * LOG_REC_SIZE) != FR_OK) return false;
+        bool ok = log.raw_aligned && session_appends(&log, opt.records, false); // disco vazio: sempre há AU livre
+        return log_close(&log) == FR_OK && ok;
+    }));
+    results.push_back(run("append + tail(1)", opt, [&] {
+        if (log_open(&log, "LOCALI.BIN", &kPeriodic) != FR_OK) return false;
+        bool ok = true;
+        for (uint32_t i = 0; ok && i < opt.records; i++) {
+            log_record_t rec, back;
+            UINT br;
+            make_record(&rec, i);
+            ok = log_append(&log, &rec, sizeof(rec), false) == FR_OK &&
+                 log_read_tail(&log, 1, &back, sizeof(back), &br) == FR_OK &&
+                 br == sizeof(back) && log_record_valid(&back);
+        }
+        return log_close(&log) == FR_OK && ok;
+    }));
+
+    results.push_back(run("sessao comprimida", opt, [&] {
+        if (log_open(&log, "LOCALI.BIN", &kCompressed) != FR_OK) return false;
+        bool ok = session_appends(&log, opt.records, false);
+        log_record_t back[8], want;
+        UINT br;
+        make_record(&want, opt.records - 1);
+        ok = ok && log_read_tail(&log, 8, back, sizeof(back), &br) == FR_OK && br > 0 &&
+             std::memcmp(&back[br / sizeof(back[0]) - 1], &want, sizeof(want)) == 0;
+        return log_close(&log) == FR_OK && ok;
+    }));
+
+    size_t dump_row = results.size();
+    results.push_back(run("despejo (f_read 127 B)", opt, [&] {
+        return dump_file(opt.records);
+    }, [&] {
+        if (log_open(&log, "LOCALI.BIN", &kPeriodic) != FR_OK) return false;
+        bool ok = session_appends(&log, opt.records, false);
+        return log_close(&log) == FR_OK && ok;
+    }));
+
+    size_t query_row = results.size();
+    uint32_t query_found[3] = {};
+    results.push_back(run("consulta 1 h (.IDX)", opt, [&] {
+        return query_hour(&log, &kPeriodic, opt.records, &query_found[0]);
+    }, [&] { return timed_session(&log, &kPeriodic, opt.records, true); }));
+    results.push_back(run("consulta 1 h (sem .IDX)", opt, [&] {
+        return query_hour(&log, &kPeriodic, opt.records, &query_found[1]);
+    }, [&] { return timed_session(&log, &kPeriodic, opt.records, false); }));
+    results.push_back(run("consulta 1 h (comprim.)", opt, [&] {
+        return query_hour(&log, &kCompressed, opt.records, &query_found[2]);
+    }, [&] { return timed_session(&log, &kCompressed, opt.records, true); }));
+
+    uint32_t reader_passes = 0;
+    results.push_back(run("sessao + leitor (2 thr)", opt, [&] {
+        if (log_open(&log, "LOCALI.BIN", &kPeriodic) != FR_OK) return false;
+        std::atomic<bool> done{false};
+        bool reader_ok = true;
+        std::thread reader([&] { reader_ok = reader_loop(done, &reader_passes); });
+        bool ok = session_appends(&log, opt.records, false);
+        done = true;
+        reader.join(); // o leitor termina antes: log_close desmonta o volume
+        ok = log_close(&log) == FR_OK && ok;
+        if (!reader_ok) std::fprintf(stderr, "leitor concorrente: erro de leitura ou registro inválido\n");
+        return ok && reader_ok;
+    }));
+
+    // Deve ser o último cenário: a thread do serviço continua rodando até o fim.
+    // O produtor segue um relógio fixo (--rate), como a amostragem no core0: um
+    // registro recusado com o anel cheio é perdido, não repetido, e os descartes
+    // são confrontados com --drop-budget.
+    double max_push_us = 0;
+    log_service_stats_t svc{};
+    results.push_back(run("servico core1 (anel)", opt, [&] {
+        if (log_open(&service_log, "LOCALI.BIN", &kPeriodic) != FR_OK) return false;
+        log_service_start(service_sink, &service_log);
+        auto start = std::chrono::steady_clock::now();
+        auto period = std::chrono::nanoseconds(1000000000ull / opt.rate);
+        for (uint32_t i = 0; i < opt.records; i++) {
+            std::this_thread::sleep_until(start + i * period);
+            log_record_t rec;
+            make_record(&rec, i);
+            auto t0 = std::chrono::steady_clock::now();
+            log_service_push(&rec, false);
+            double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+            if (us > max_push_us) max_push_us = us;
+        }
+        while (log_service_pending()) std::this_thread::yield();
+        log_service_get_stats(&svc);
+        return log_close(&service_log) == FR_OK && svc.errors == 0 && svc.written == svc.pushed;
+    }));
+
+    std::printf("%u registros de %u bytes, latência simulada: cmd %u us, setor %u us, busy %u us\n\n",
+                opt.records, LOG_REC_SIZE, lat.cmd_us, lat.sector_us, lat.write_busy_us);
+    std::printf("%-22s %9s %10s %10s %9s %10s\n", "cenario", "reg/s", "set.lidos", "set.escr.", "amp.escr", "cache");
+    for (const auto &r : results) print_result(r);
+    const result &dump = results[dump_row];
+    std::printf("\ndespejo: %llu setores em %llu comandos de leitura (%u leituras antecipadas), %.0f KiB/s simulados\n",
+                (unsigned long long)dump.io.sectors_read, (unsigned long long)dump.io.read_cmds, dump.cache.readahead_fills,
+                opt.records * (double)LOG_REC_SIZE / 1024.0 / (dump.io.sim_us / 1e6));
+    for (int i = 0; i < 3; i++) {
+        const result &q = results[query_row + i];
+        std::printf("%s: %u registros, %llu setores lidos\n", q.name, query_found[i],
+                    (unsigned long long)q.io.sectors_read);
+    }
+    std::printf("leitor concorrente: %u leituras completas do arquivo\n", reader_passes);
+    codec_result codec = codec_roundtrip(opt.records);
+    std::printf("compressao: %u quadros de %u bytes, razao %.3f, codifica %.2f us/reg, decodifica %.2f us/reg%s\n",
+                codec.frames, LOG_CODEC_FRAME_SIZE, codec.frames * (double)LOG_CODEC_FRAME_SIZE / (opt.records * (double)LOG_REC_SIZE),
+                codec.encode_us, codec.decode_us, codec.ok ? "" : " (ERRO na conferencia)");
+    bool drops_ok = svc.dropped <= opt.drop_budget;
+    std::printf("servico core1 a %u reg/s: %u gravados, %u descartados (orcamento %u)%s, pico do anel %u/%u, "
+                "push máx %.1f us\n",
+                opt.rate, svc.written, svc.dropped, opt.drop_budget, drops_ok ? "" : " (ACIMA do orcamento)",
+                svc.high_watermark, LOG_SERVICE_RING_SIZE, max_push_us);
+    std::printf("servico core1: parada máx. %.1f ms (prevista %u ms); o anel cobre %.1f ms a %u reg/s\n",
+                svc.stall_max_us / 1000.0, LOG_SERVICE_STALL_MS, LOG_SERVICE_RING_SIZE * 1000.0 / opt.rate, opt.rate);
+
+    ram_disk_close();
+    return codec.ok && drops_ok ? 0 : 1;
+}
@@ -0,0 +1,150 @@
+// Decodificador de logs binários do SD Card (locali.bin / dista.bin) para CSV.
+//
+// Uso: sdlog_decode <arquivo.bin> [saida.csv]
+//
+// A coluna utc é preenchida a partir do último registro de sincronização de
+// hora (LOG_REC_TIME_SYNC) visto no arquivo; antes dele fica vazia.
+//
+// Registros com marcador ou CRC inválidos são descartados e a leitura se
+// ressincroniza procurando o próximo LOG_REC_MAGIC byte a byte (cobre o
+// preenchimento com zeros do modo contíguo e setores corrompidos).
+//
+// Logs comprimidos (policy.compress) são descomprimidos: em cada início de
+// setor, um quadro log_codec válido é decodificado inteiro; um quadro
+// corrompido é descartado sem afetar os setores seguintes.
+
+#include "log_codec.h"
+#include "log_record.h"
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+namespace {
+
+// Escreve um valor em 1e-7 grau como decimal exato (sem arredondamento de float)
+void write_e7(std::FILE *out, int32_t v) {
+    uint32_t u = v < 0 ? static_cast<uint32_t>(-static_cast<int64_t>(v)) : static_cast<uint32_t>(v);
+    std::fprintf(out, "%s%" PRIu32 ".%07" PRIu32, v < 0 ? "-" : "", u / 10000000u, u % 10000000u);
+}
+
+const char *type_name(uint8_t type) {
+    switch (type) {
+    case LOG_REC_GPS_POS:    return "gps_pos";
+    case LOG_REC_DIST_ALERT: return "dist_alert";
+    case LOG_REC_TIME_SYNC:  return "time_sync";
+    default:                 return "unknown";
+    }
+}
+
+// Âncora de tempo do último registro LOG_REC_TIME_SYNC (boot ms <-> Unix)
+struct time_anchor {
+    bool valid = false;
+    uint32_t t_ms = 0;
+    int64_t unix_s = 0;
+};
+
+// Hora UTC ISO 8601 de um registro, se houver âncora (vazio caso contrário)
+void write_utc(std::FILE *out, const time_anchor &anchor, uint32_t t_ms) {
+    if (!anchor.valid) return;
+    int64_t ms = static_cast<int64_t>(anchor.unix_s) * 1000 + (static_cast<int64_t>(t_ms) - anchor.t_ms);
+    std::time_t secs = static_cast<std::time_t>(ms / 1000);
+    std::tm tm{};
+    if (!gmtime_r(&secs, &tm)) return;
+    char buf[32];
+    std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S", &tm);
+    std::fprintf(out, "%s.%03dZ", buf, static_cast<int>(ms % 1000));
+}
+
+void write_csv_row(std::FILE *out, const log_record_t &rec, time_anchor &anchor) {
+    if (rec.type == LOG_REC_TIME_SYNC) {
+        anchor.valid = rec.a != 0; // a = 0: boot sem hora
+        anchor.t_ms = rec.t_ms;
+        anchor.unix_s = static_cast<uint32_t>(rec.a);
+    }
+
+    std::fprintf(out, "%" PRIu32 ",", rec.t_ms);
+    write_utc(out, anchor, rec.t_ms);
+    std::fprintf(out, ",%s,", type_name(rec.type));
+    switch (rec.type) {
+    case LOG_REC_GPS_POS: // lat,lon em graus
+        write_e7(out, rec.a);
+        std::fputc(',', out);
+        write_e7(out, rec.b);
+        break;
+    default: // inteiros crus
+        std::fprintf(out, "%" PRId32 ",%" PRId32, rec.a, rec.b);
+        break;
+    }
+    std::fputc('\n', out);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    if (argc < 2 || argc > 3) {
+        std::cerr << "uso: " << argv[0] << " <arquivo.bin> [saida.csv]\n";
+        return 2;
+    }
+
+    std::ifstream in(argv[1], std::ios::binary);
+    if (!in) {
+        std::cerr << "não foi possível abrir " << argv[1] << "\n";
+        return 1;
+    }
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    std::FILE *out = stdout;
+    if (argc == 3 && !(out = std::fopen(argv[2], "w"))) {
+        std::cerr << "não foi possível criar " << argv[2] << "\n";
+        return 1;
+    }
+
+    std::fprintf(out, "t_ms,utc,type,a,b\n");
+
+    time_anchor anchor;
+    size_t ok = 0, skipped = 0, frames = 0;
+    size_t pos = 0;
+    struct emit_ctx {
+        std::FILE *out;
+        time_anchor *anchor;
+    } ctx{out, &anchor};
+    auto emit = [](const log_record_t *rec, void *p) {
+        auto *c = static_cast<emit_ctx *>(p);
+        write_csv_row(c->out, *rec, *c->anchor);
+    };
+    while (pos + LOG_REC_SIZE <= data.size()) {
+        if (pos % LOG_CODEC_FRAME_SIZE == 0 && pos + LOG_CODEC_FRAME_SIZE <= data.size() &&
+            data[pos] == LOG_CODEC_MAGIC) {
+            int n = log_codec_decode(&data[pos], emit, &ctx);
+            if (n >= 0) {
+                ok += static_cast<size_t>(n);
+                frames++;
+                pos += LOG_CODEC_FRAME_SIZE;
+                continue;
+            }
+        }
+
+        log_record_t rec;
+        std::memcpy(&rec, &data[pos], sizeof(rec));
+        if (log_record_valid(&rec)) {
+            write_csv_row(out, rec, anchor);
+            ok++;
+            pos += LOG_REC_SIZE;
+        } else {
+            skipped++;
+            pos++;
+        }
+    }
+
+    if (out != stdout) std::fclose(out);
+    std::cerr << ok << " registros decodificados (" << frames << " quadros comprimidos), "
+              << skipped << " bytes descartados\n";
+    return 0;
+}
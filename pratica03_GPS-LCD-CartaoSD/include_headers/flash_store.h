@@ -0,0 +1,83 @@
+#ifndef FLASH_STORE_H
+#define FLASH_STORE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "ff.h"         // FRESULT
+#include "log_record.h" // log_record_t
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ==========================
+// Armazenamento log-structured na flash QSPI (estágio antes do SD)
+// ==========================
+// Anel de setores de 4 KiB no fim da flash. Registros são agrupados em páginas
+// de 256 bytes (cabeçalho + 15 registros) e cada setor é apagado só pouco antes
+// de o escritor voltar a ele, então o desgaste se distribui por todo o anel. O dreno
+// copia setores inteiros para o SD (escrita sequencial grande + um f_sync) e só
+// então marca o setor como drenado. Sobrevive a falhas do cartão e a resets.
+//
+// Cada operação na flash trava o core0 em RAM, com interrupções desligadas
+// (flash_safe_execute). Programar uma página leva ~0,7 ms (máx. 3 ms no W25Q16JV),
+// menos que os ~33 ms que a FIFO de 32 bytes de uma UART a 9600 baud aguenta.
+// Apagar um setor leva ~45 ms (máx. 400 ms) e por isso nunca acontece dentro de
+// flash_store_append: o setor seguinte ao de escrita (reserva) é apagado antes
+// de ser preciso, por flash_store_poll com o core1 ocioso e, com
+// FLASH_STORE_ERASE_GATED, só numa janela liberada pelo core0
+// (flash_store_allow_erase). Sem reserva apagada, a flash recusa o registro.
+#ifndef FLASH_STORE_BYTES
+#define FLASH_STORE_BYTES (256 * 1024) // Área reservada no fim da flash (64 setores)
+#endif
+#ifndef FLASH_STORE_PAGE_MS
+#define FLASH_STORE_PAGE_MS 5000 // Idade máxima de uma página parcial em RAM
+#endif
+#ifndef FLASH_STORE_EVENT_MS
+#define FLASH_STORE_EVENT_MS 500 // Idade máxima de uma página parcial com evento
+#endif
+#ifndef FLASH_STORE_ERASE_GATED
+#define FLASH_STORE_ERASE_GATED 0 // 1: apaga só nas janelas de flash_store_allow_erase
+#endif
+#define FLASH_STORE_ERASE_MS 50 // Janela mínima para começar um apagamento (típico: 45 ms)
+#ifndef FLASH_STORE_DRAIN_MS
+#define FLASH_STORE_DRAIN_MS 60000 // Idade máxima do setor em escrita antes do dreno
+#endif
+#define FLASH_STORE_RETRY_MS 1000 // Espera após falha do SD no dreno
+
+// Destino do dreno: grava um registro e confirma o lote (f_sync)
+typedef FRESULT (*flash_store_sink_t)(const log_record_t *rec, bool event);
+typedef FRESULT (*flash_store_commit_t)(void);
+
+typedef struct {
+    uint32_t staged;        // Registros aceitos
+    uint32_t rejected;      // Registros recusados (anel cheio ou flash indisponível)
+    uint32_t drained;       // Registros entregues ao SD
+    uint32_t pages;         // Páginas programadas
+    uint32_t erases;        // Setores apagados
+    uint32_t spare_misses;  // Páginas adiadas por falta de reserva apagada
+    uint32_t lockouts;      // Operações com o core0 travado (apagar + programar)
+    uint32_t lockout_max_us; // Maior travamento do core0
+    uint32_t lockout_losses; // Perdas de periférico (flash_store_note_loss) logo após um travamento
+    uint32_t drain_errors;  // Tentativas de dreno interrompidas pelo SD
+    uint32_t used_sectors;  // Setores com dados ainda não drenados
+} flash_store_stats_t;
+
+extern bool flash_store_init(void);
+extern bool flash_store_append(const log_record_t *rec, bool event);
+extern void flash_store_poll(flash_store_sink_t sink, flash_store_commit_t commit);
+extern bool flash_store_pending(void);
+extern void flash_store_get_stats(flash_store_stats_t *stats);
+
+// Core0: o core1 pode apagar a reserva nos próximos window_ms (0 = agora não)
+extern void flash_store_allow_erase(uint32_t window_ms);
+// Core0 (também de ISR): um periférico perdeu dados, ex.: estouro da FIFO de uma
+// UART. Ligada pela aplicação ao gancho do driver; conta se veio de um travamento.
+extern void flash_store_note_loss(void);
+extern void flash_store_dump(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -2,12 +2,59 @@
 #define GPS_GY_NEO6MV2
 
 #include "pico/stdlib.h"
+#include "nmea.h"         // nmea_sentence_t
+#include "time_service.h" // utc_time_t
 
 #define UART_ID uart0 // Usa a UART0 da Pico
 
+// Recepção por interrupção: a ISR esvazia a FIFO de 32 bytes da UART num anel
+// em RAM, e o laço principal consome sentenças NMEA dele quando estiver livre
+#define GPS_RX_BUF_SIZE 4096 // Anel de recepção (potência de 2): ~4 s de NMEA a 9600 baud
+
+// O NEO-6M manda uma rajada de sentenças por segundo (~0,5 s a 9600 baud) e
+// fica em silêncio até a próxima: é aí que a flash pode travar o core0
+#define GPS_EPOCH_MS  1000 // Período das rajadas (1 Hz, padrão do módulo)
+#define GPS_GAP_MS    20   // Linha parada por esse tempo: a rajada terminou
+#define GPS_MARGIN_MS 50   // Folga antes da próxima rajada
+#define GPS_LOST_MS   3000 // Sem bytes por esse tempo: sem GPS, nada a perder
+
+typedef struct {
+    uint32_t rx_bytes;       // Bytes recebidos pela interrupção
+    uint32_t ring_overflows; // Bytes descartados com o anel cheio (consumidor atrasado)
+    uint32_t fifo_overruns;  // Estouros da FIFO da UART (interrupção atrasada)
+    uint32_t line_errors;    // Bytes com erro de enquadramento, paridade ou break
+    uint32_t high_watermark; // Maior ocupação do anel (bytes)
+    nmea_stats_t nmea;       // Sentenças aceitas e rejeitadas pelo tokenizador
+} gps_uart_stats_t;
+
+// Estado do receptor montado a partir de RMC, GGA, GSA, GSV, VTG e ZDA de
+// qualquer talker (GP, GN, GL, ...). Só inteiros: DOPs, velocidade e rumo em
+// centésimos, posição em 1e-7 grau (negativo = Sul/Oeste).
+typedef struct {
+    bool valid;            // Já houve posição válida (RMC 'A' ou GGA com qualidade > 0)
+    int32_t lat;           // Latitude (1e-7 grau)
+    int32_t lon;           // Longitude (1e-7 grau)
+    int32_t alt_dm;        // Altitude sobre o nível do mar (decímetros, GGA)
+    uint8_t quality;       // GGA: 0 = sem fix, 1 = GPS, 2 = DGPS, ...
+    uint8_t fix_type;      // GSA: 1 = sem fix, 2 = 2D, 3 = 3D
+    uint8_t sats_used;     // Satélites na solução (GGA)
+    uint8_t sats_in_view;  // Satélites visíveis, somando as constelações (GSV)
+    uint8_t snr_max;       // Melhor SNR do último ciclo GSV (dB-Hz)
+    uint16_t pdop, hdop, vdop; // Diluição de precisão x100 (GSA; HDOP também do GGA)
+    int32_t speed_kmh;     // Velocidade em km/h x100 (VTG)
+    uint16_t course;       // Rumo verdadeiro em graus x100 (VTG)
+    bool utc_valid;        // utc preenchido (RMC ou ZDA)
+    utc_time_t utc;        // Última hora recebida
+} gps_fix_t;
+
 extern void setup_gps();
-extern bool parse_gprmc(char *sentence, double *lat_out, double *lon_out);
-extern bool parse_gpgga(char *sentence, double *lat_out, double *lon_out);
+extern const nmea_sentence_t *gps_read_sentence(void);
+extern void gps_uart_get_stats(gps_uart_stats_t *stats);
+extern void gps_uart_dump(void);
+extern uint32_t gps_uart_quiet_ms(void);
+// Gancho opcional chamado da ISR a cada estouro da FIFO (ex.: para atribuir a perda)
+extern void gps_uart_set_overrun_hook(void (*hook)(void));
+extern bool gps_handle_sentence(const nmea_sentence_t *s, gps_fix_t *fix);
 #endif
 
 
@@ -0,0 +1,50 @@
+#ifndef LOG_CODEC_H
+#define LOG_CODEC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "log_record.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ==========================
+// Compressão dos registros em quadros de um setor (LZSS estilo heatshrink)
+// ==========================
+// Cada quadro ocupa exatamente um setor e é decodificável sozinho: um setor
+// perdido não afeta os outros e a leitura do fim do log lê só o último setor.
+// Os registros passam antes por um delta campo a campo contra o anterior (o CRC
+// de cada registro sai do fluxo e é refeito na decodificação; o quadro tem o
+// seu), então posições quase paradas viram sequências repetidas que o LZSS
+// troca por uma referência de 13 bits.
+//
+// Quadro: magic, reservado, count (u16), len (u16), crc (u16), payload[len]
+// Payload: 1 + 8 bits = literal; 0 + 8 bits (distância - 1) + 4 bits
+// (comprimento - 2) = cópia de até 17 bytes da janela de 256 bytes.
+#define LOG_CODEC_FRAME_SIZE 512  // Um setor
+#define LOG_CODEC_MAGIC      0xC5 // Primeiro byte do quadro (registros crus começam com 0xA5)
+#define LOG_CODEC_HDR_SIZE   8
+#define LOG_CODEC_WINDOW     256  // Janela do LZSS (bytes)
+
+typedef struct {
+    uint8_t *frame;                   // Quadro em montagem (LOG_CODEC_FRAME_SIZE bytes)
+    uint32_t bits;                    // Bits usados no payload
+    uint16_t count;                   // Registros no quadro
+    uint32_t pos;                     // Bytes do fluxo delta no quadro
+    log_record_t prev;                // Último registro (base do delta)
+    uint8_t window[LOG_CODEC_WINDOW]; // Últimos bytes do fluxo delta
+} log_codec_t;
+
+typedef void (*log_codec_emit_t)(const log_record_t *rec, void *ctx);
+
+extern void log_codec_begin(log_codec_t *codec, uint8_t *frame);
+extern bool log_codec_put(log_codec_t *codec, const log_record_t *rec);
+extern void log_codec_finish(log_codec_t *codec);
+extern int log_codec_decode(const uint8_t *frame, log_codec_emit_t emit, void *ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef LOG_RECORD_H
+#define LOG_RECORD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ==========================
+// Registro binário de tamanho fixo dos logs no SD
+// ==========================
+// 16 bytes, little-endian (RP2040 e PC). 512 / 16 = 32 registros por setor,
+// então em arquivos novos nenhum registro atravessa a fronteira de um setor.
+#define LOG_REC_MAGIC 0xA5 // Primeiro byte de todo registro (ressincronização)
+#define LOG_REC_SIZE  16   // Tamanho fixo do registro
+
+typedef enum {
+    LOG_REC_GPS_POS    = 1, // a = latitude, b = longitude (1e-7 grau)
+    LOG_REC_DIST_ALERT = 2, // a = distância medida (mm), b = reservado
+    LOG_REC_TIME_SYNC  = 3, // a = hora UTC em segundos Unix no instante t_ms (0: boot sem hora), b = reservado
+} log_rec_type_t;
+
+typedef struct {
+    uint8_t magic;  // LOG_REC_MAGIC
+    uint8_t type;   // log_rec_type_t
+    uint16_t crc;   // CRC-16/CCITT dos 16 bytes com este campo zerado
+    uint32_t t_ms;  // Instante do registro (ms desde o boot)
+    int32_t a;      // Carga útil em inteiros escalados (ver log_rec_type_t)
+    int32_t b;
+} log_record_t;
+
+
+extern uint16_t log_crc16(const void *data, size_t len);
+extern uint16_t log_crc16_update(uint16_t crc, const void *data, size_t len);
+extern void log_record_make(log_record_t *rec, uint8_t type, uint32_t t_ms, int32_t a, int32_t b);
+extern bool log_record_valid(const log_record_t *rec);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef LOG_SERVICE_H
+#define LOG_SERVICE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "ff.h"         // FRESULT
+#include "log_record.h" // log_record_t
+#include "sd_logger.h"  // log_t
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Serviço de log no core1 (write-behind): o core0 enfileira registros num anel
+// SPSC sem trava e volta imediatamente; o core1 retira, agrupa em setores
+// (buffer do sd_logger) e espera o cartão. Amostragem nunca espera o SD.
+
+// O anel absorve o produtor enquanto o core1 está parado. Pior parada prevista:
+// um apagamento de setor da flash (máx. 400 ms, no dreno ocioso) ou o busy de
+// escrita de um cartão SDXC (timeout de 500 ms pela especificação). A essa
+// parada, LOG_SERVICE_MAX_RATE_HZ registros/s cabem sem descarte; as práticas
+// produzem 1 a 2 registros/s.
+#define LOG_SERVICE_STALL_MS    500  // Pior parada do core1 (sink ou trabalho ocioso)
+#define LOG_SERVICE_MAX_RATE_HZ 256  // Taxa sustentada que o anel cobre durante a parada
+#define LOG_SERVICE_RING_SIZE   256  // Registros no anel (potência de 2): 256 x 20 bytes
+#define LOG_SERVICE_IDLE_US   2000   // Pausa do core1 com o anel vazio
+#if FF_USE_LFN
+#define LOG_SERVICE_STACK_WORDS 1536 // Pilha do core1 (6 KiB: FatFs com buffer de nomes longos + printf)
+#else
+#define LOG_SERVICE_STACK_WORDS 1024 // Pilha do core1 (4 KiB: FatFs + printf)
+#endif
+
+// Grava um registro no log (roda no core1). Ex.: rotação + log_append
+typedef FRESULT (*log_service_sink_t)(const log_record_t *rec, bool event);
+// Trabalho extra do core1 com o anel vazio (ex.: dreno da flash para o SD)
+typedef void (*log_service_idle_t)(void);
+
+typedef struct {
+    uint32_t pushed;         // Registros aceitos no anel (core0)
+    uint32_t dropped;        // Registros descartados com o anel cheio (core0)
+    uint32_t high_watermark; // Maior ocupação do anel observada pelo produtor
+    uint32_t written;        // Registros entregues ao sink com sucesso (core1)
+    uint32_t errors;         // Registros recusados pelo sink (core1)
+    uint32_t stall_max_us;   // Maior parada do core1 (sink ou trabalho ocioso); compare com LOG_SERVICE_STALL_MS
+} log_service_stats_t;
+
+extern void log_service_start(log_service_sink_t sink, log_t *log);
+extern void log_service_set_idle(log_service_idle_t idle);
+extern bool log_service_push(const log_record_t *rec, bool event);
+extern uint32_t log_service_pending(void);
+extern void log_service_get_stats(log_service_stats_t *stats);
+extern void log_service_dump(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef NMEA_H
+#define NMEA_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "time_service.h" // utc_time_t
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ==========================
+// Tokenizador NMEA 0183 de passada única
+// ==========================
+// Máquina de estados alimentada byte a byte (direto do anel da UART). Cada byte
+// é gravado uma única vez no buffer da sentença; as vírgulas viram '\0' e o
+// início de cada campo é anotado na mesma passada, então os campos já saem como
+// strings C sem cópia nem nova varredura. Campos vazios ("$GPRMC,,V,,,,")
+// continuam ocupando o seu índice, ao contrário do strtok. O XOR do checksum
+// "*hh" também é acumulado byte a byte: a sentença só é entregue se conferir, e
+// é abandonada no primeiro dígito errado.
+#define NMEA_MAX_LEN    128 // Maior sentença aceita (82 pela norma) + \0
+#define NMEA_MAX_FIELDS 24  // Campos por sentença (GSV usa até 20)
+
+typedef struct {
+    char buf[NMEA_MAX_LEN];               // Campos separados por '\0' (sem '$', sem checksum)
+    uint8_t field[NMEA_MAX_FIELDS];       // Deslocamento de cada campo em buf
+    uint8_t count;                        // Campos na sentença (o 0 é o endereço, ex.: "GPRMC")
+} nmea_sentence_t;
+
+typedef enum {
+    NMEA_WAIT_START, // Descartando até o próximo '$'
+    NMEA_BODY,       // Campos da sentença
+    NMEA_CHECKSUM,   // Dígitos hexadecimais após '*'
+    NMEA_END,        // Checksum conferido, esperando o fim da linha
+} nmea_state_t;
+
+typedef struct {
+    uint32_t sentences;       // Sentenças entregues (checksum conferido)
+    uint32_t checksum_errors; // Checksum diferente do calculado
+    uint32_t truncated;       // Linha terminada ou interrompida por '$' antes do "*hh"
+    uint32_t overflows;       // Sentenças com bytes ou campos demais
+} nmea_stats_t;
+
+typedef struct {
+    nmea_state_t state;
+    uint8_t len;         // Bytes usados em sentence.buf
+    uint8_t sum;         // XOR dos bytes entre '$' e '*'
+    uint8_t digits;      // Dígitos do checksum já conferidos
+    nmea_stats_t stats;
+    nmea_sentence_t sentence;
+} nmea_parser_t;
+
+extern void nmea_init(nmea_parser_t *p);
+extern const nmea_sentence_t *nmea_feed(nmea_parser_t *p, char c);
+
+// Campo idx da sentença ("" se não existir)
+static inline const char *nmea_field(const nmea_sentence_t *s, uint8_t idx) {
+    return idx < s->count ? &s->buf[s->field[idx]] : "";
+}
+
+// Conversões de campos, sem ponto flutuante (false: campo vazio ou inválido)
+extern bool nmea_to_e7(const char *s, char hemi, int32_t max_deg, int32_t *out);
+extern bool nmea_to_fixed(const char *s, int decimals, int32_t *out);
+extern bool nmea_time(const char *t, utc_time_t *utc);
+extern bool nmea_date(const char *d, utc_time_t *utc);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,9 +1,12 @@
 #ifndef SD_CARD_H
 #define SD_CARD_H
 
+#include <stdint.h>
 
 extern void init_spi_sdcard();
-extern void write_to_sd(double lat, double lon);
+extern void write_to_sd(int32_t lat_e7, int32_t lon_e7);
 extern void read_from_sd();
+extern void read_tail_from_sd(unsigned int n);
+extern void read_range_from_sd(uint32_t from_s, uint32_t to_s);
 
 #endif
\ No newline at end of file
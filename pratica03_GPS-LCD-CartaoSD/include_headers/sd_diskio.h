@@ -0,0 +1,102 @@
+#ifndef SD_DISKIO_H
+#define SD_DISKIO_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "ff.h"     // LBA_t
+#include "diskio.h" // DRESULT
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ==========================
+// Backend do drive 0 (meio físico por trás do diskio)
+// ==========================
+typedef struct {
+    DSTATUS (*initialize)(void);                              // 0 = pronto
+    DRESULT (*read)(BYTE *buff, LBA_t sector, UINT count);
+    DRESULT (*write)(const BYTE *buff, LBA_t sector, UINT count);
+    DRESULT (*sync)(void);                                    // conclui escritas pendentes
+    DRESULT (*ioctl)(BYTE cmd, void *buff);                   // GET_SECTOR_SIZE/COUNT, GET_BLOCK_SIZE
+} disk_backend_t;
+
+extern const disk_backend_t sd_spi_backend; // Cartão SD por SPI (sd_spi.c)
+extern uint32_t sd_spi_crc_errors(void);     // Blocos com CRC16 divergente (sd_spi.c)
+extern void disk_set_backend(const disk_backend_t *backend);
+
+// ==========================
+// Cache de setores write-back (diskio.c)
+// ==========================
+#ifndef DISK_CACHE_SECTORS
+#define DISK_CACHE_SECTORS 8 // Linhas de 512 bytes em RAM (0 desativa o cache)
+#endif
+#define DISK_CACHE_MAX_PIN_RANGES 2 // Faixas de setores de metadados (FAT, diretório)
+#ifndef DISK_READAHEAD_SECTORS
+#define DISK_READAHEAD_SECTORS 8 // Setores trazidos por leitura antecipada (0 desativa)
+#endif
+
+// Contadores para dimensionar o cache contra o orçamento de RAM
+typedef struct {
+    uint32_t read_hits;    // Setores lidos servidos pelo cache
+    uint32_t read_misses;  // Setores lidos do cartão
+    uint32_t write_hits;   // Escritas que atualizaram uma linha já presente
+    uint32_t write_misses; // Escritas que alocaram linha nova ou foram direto ao cartão
+    uint32_t evictions;    // Linhas substituídas (LRU)
+    uint32_t writebacks;   // Linhas sujas gravadas no cartão (evicção ou CTRL_SYNC)
+    uint32_t readahead_fills; // Leituras antecipadas (um comando de vários setores cada)
+    uint32_t readahead_hits;  // Setores lidos servidos pela leitura antecipada
+} disk_cache_stats_t;
+
+extern void disk_cache_pin_range(LBA_t start, LBA_t count);
+extern void disk_cache_clear_pins(void);
+extern void disk_cache_get_stats(disk_cache_stats_t *stats);
+extern void disk_cache_reset_stats(void);
+
+// ==========================
+// Latências do meio físico (diskio.c): histogramas log2 em microssegundos
+// ==========================
+#ifndef DISK_LAT_STATS
+#define DISK_LAT_STATS 1 // 0 remove a instrumentação
+#endif
+#define DISK_LAT_BUCKETS 21 // Faixa i: [2^i, 2^(i+1)) us; a última acumula >= ~1 s
+
+typedef enum {
+    DISK_LAT_CMD,   // Envio do comando até a resposta R1
+    DISK_LAT_TOKEN, // Espera do token 0xFE de um bloco lido
+    DISK_LAT_XFER,  // Transferência dos dados de um bloco (e CRC)
+    DISK_LAT_BUSY,  // Espera pelo fim da programação de uma escrita anterior
+    DISK_LAT_READ,  // Leitura no meio físico (chamada ao backend)
+    DISK_LAT_WRITE, // Escrita no meio físico (direta ou write-back do cache)
+    DISK_LAT_SYNC,  // CTRL_SYNC completo (flush do cache + busy)
+    DISK_LAT_PHASES
+} disk_lat_phase_t;
+
+typedef struct {
+    uint32_t count;
+    uint64_t total_us;
+    uint32_t buckets[DISK_LAT_BUCKETS];
+    uint32_t max_us;     // Pior amostra da fase...
+    LBA_t max_sector;    // ...setor da operação em curso
+    uint32_t max_t_ms;   // ...e instante (ms desde o boot)
+} disk_lat_hist_t;
+
+typedef struct {
+    disk_lat_hist_t phase[DISK_LAT_PHASES];
+} disk_lat_stats_t;
+
+#if DISK_LAT_STATS
+extern void disk_lat_record(disk_lat_phase_t phase, uint32_t us); // Chamado pelos backends
+#else
+static inline void disk_lat_record(disk_lat_phase_t phase, uint32_t us) { (void)phase; (void)us; }
+#endif
+extern void disk_lat_get_stats(disk_lat_stats_t *stats);
+extern void disk_lat_reset_stats(void);
+extern void disk_lat_dump(void);
+extern bool disk_lat_dump_periodic(uint32_t interval_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
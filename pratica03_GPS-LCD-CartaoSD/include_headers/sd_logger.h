@@ -0,0 +1,135 @@
+#ifndef SD_LOGGER_H
+#define SD_LOGGER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "ff.h" // FIL, FRESULT, UINT
+#include "log_codec.h" // Quadros comprimidos (policy.compress)
+#include "log_record.h" // log_record_t (índice esparso e consultas por hora)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LOG_BUF_SIZE 512 // Buffer em RAM de uma sessão (1 setor do cartão)
+#define LOG_INDEX_SIZE 32 // Registros recentes indexados em RAM (offset)
+#if FF_USE_LFN
+#define LOG_NAME_SIZE 48  // "DIRETORIO/AAAA-MM-DD_nn.bin" (perfil exFAT/LFN)
+#else
+#define LOG_NAME_SIZE 28  // "DIRETORIO/AAMMDDnn.BIN" (nomes 8.3)
+#endif
+#define LOG_PRUNE_BATCH 8 // Arquivos apagados por varredura do diretório em log_prune_before
+#define LOG_EXPAND_TRIES 16 // Buscas por área livre alinhada à AU em log_open_contiguous
+#define LOG_CLMT_SIZE 32  // Itens da tabela de clusters (fast seek): até (32 - 2) / 2 fragmentos
+#define LOG_SPARSE_EVERY 64   // Registros entre entradas do índice esparso (.IDX)
+#define LOG_SPARSE_PENDING 8  // Entradas do índice esparso em RAM até o próximo log_flush
+#define LOG_SPARSE_MAGIC 0x5849 // "IX"
+
+
+// Política de sincronização (f_sync) de uma sessão de log.
+// Cada critério é independente; valor 0/false desativa o critério.
+typedef struct {
+    uint32_t sync_interval_ms; // f_sync quando passar esse tempo desde o último sync
+    uint32_t sync_bytes;       // f_sync quando esse número de bytes tiver sido anexado desde o último sync
+    bool sync_on_event;        // f_sync imediato quando log_append recebe event = true
+    bool compress;             // Grava quadros comprimidos (log_codec) em vez de registros
+                               // crus; log_append só aceita log_record_t e log_read_from
+                               // não se aplica (FR_DENIED)
+} log_policy_t;
+
+// Entrada do índice em RAM: onde começa um registro
+typedef struct {
+    FSIZE_t offset; // Offset do início do registro no arquivo
+} log_index_entry_t;
+
+// Entrada do índice esparso em arquivo (mesmo nome do log, extensão .IDX): a
+// cada LOG_SPARSE_EVERY registros, onde começa um registro e a sua hora UTC.
+// As entradas só crescem em unix_s, então a busca binária vale no arquivo todo.
+typedef struct {
+    uint32_t unix_s; // Hora UTC do registro (segundos Unix)
+    uint32_t t_ms;   // t_ms do registro: base de hora para os seguintes
+    uint32_t offset; // Offset do registro no log (com compressão, do quadro)
+    uint16_t magic;  // LOG_SPARSE_MAGIC
+    uint16_t crc;    // CRC-16 dos 16 bytes com este campo zerado
+} log_sparse_entry_t;
+
+// Base para deduzir a hora UTC de um registro pelo seu t_ms
+typedef struct {
+    bool valid;      // Houve um LOG_REC_TIME_SYNC (ou entrada do índice) desde o boot do registro
+    uint32_t unix_s; // Hora UTC em t_ms
+    uint32_t t_ms;
+} log_time_base_t;
+
+// Registro encontrado por log_query_time, com a hora UTC deduzida
+typedef void (*log_query_emit_t)(const log_record_t *rec, uint32_t unix_s, void *ctx);
+
+// Sessão de log: volume montado e arquivo aberto durante toda a sessão
+typedef struct {
+    FIL fil;                   // Arquivo aberto (modo append)
+    bool is_open;              // Sessão ativa
+    log_policy_t policy;       // Política de sincronização
+    uint8_t buf[LOG_BUF_SIZE]; // Setor em montagem: fim do log desde a última fronteira de setor
+    UINT buf_len;              // Bytes ocupados em buf (end - buf_len é múltiplo de LOG_BUF_SIZE)
+    UINT buf_written;          // Bytes de buf já entregues ao FatFs (setor incompleto)
+    uint32_t unsynced_bytes;   // Bytes anexados desde o último f_sync
+    uint32_t last_sync_ms;     // Instante (ms desde o boot) do último f_sync
+    FSIZE_t end;               // Tamanho lógico do log (arquivo + buffer em RAM)
+    log_index_entry_t index[LOG_INDEX_SIZE]; // Anel com os últimos registros anexados
+    UINT index_head;           // Próxima posição livre do anel
+    UINT index_count;          // Entradas válidas no anel
+    DWORD clmt[LOG_CLMT_SIZE]; // Mapa de clusters do arquivo (CLMT do FatFs)
+    UINT clmt_used;            // Itens usados em clmt (inclui o terminador)
+    DWORD clmt_last_clust;     // Último cluster do arquivo já mapeado
+    bool clmt_valid;           // Mapa completo: seeks usam o modo fast seek
+    char name[LOG_NAME_SIZE];  // Caminho do arquivo aberto
+    bool rotating;             // Arquivos por data com tamanho máximo (log_open_rotating)
+    char dir[13];              // Diretório dos arquivos rotativos
+    FSIZE_t max_file_bytes;    // Tamanho máximo de cada arquivo rotativo
+    uint32_t file_date;        // Data AAMMDD do arquivo atual (0 = relógio sem hora)
+    UINT file_seq;             // Sequência do arquivo dentro da data (00..99)
+    bool file_changed;         // Novo arquivo aberto: cabeçalho pendente (limpo pelo usuário)
+    bool raw;                  // Modo contíguo: setores gravados direto pelo diskio
+    LBA_t raw_first_sector;    // Primeiro setor do arquivo pré-alocado
+    LBA_t raw_sector;          // Setor (relativo ao arquivo) sendo preenchido pelo buffer
+    FSIZE_t raw_capacity;      // Bytes pré-alocados (f_expand)
+    bool raw_aligned;          // Área pré-alocada começa numa fronteira de AU
+    log_codec_t codec;         // Compressão: quadro em montagem (em buf)
+    FSIZE_t frame_start;       // Offset do quadro em montagem (múltiplo de LOG_BUF_SIZE)
+    bool frame_dirty;          // Quadro com registros ainda não gravados no arquivo
+    FIL idx_fil;               // Índice esparso (.IDX) do arquivo aberto
+    bool idx_open;             // Índice disponível (senão as consultas varrem o log)
+    bool idx_dirty;            // Entradas gravadas desde o último f_sync do índice
+    log_sparse_entry_t idx_pending[LOG_SPARSE_PENDING]; // Entradas ainda não gravadas
+    UINT idx_pending_count;
+    UINT idx_since;            // Registros desde a última entrada
+    uint32_t idx_last_unix;    // Hora da última entrada (0 = nenhuma)
+    log_time_base_t time_base; // Última sincronização de hora anexada
+} log_t;
+
+
+extern FRESULT log_open(log_t *log, const char *filename, const log_policy_t *policy);
+extern FRESULT log_open_rotating(log_t *log, const char *dir, const log_policy_t *policy, FSIZE_t max_file_bytes);
+extern FRESULT log_check_rotation(log_t *log, UINT len, uint32_t unix_s);
+extern FRESULT log_prune_before(log_t *log, uint32_t date);
+extern FRESULT log_open_contiguous(log_t *log, const char *filename, const log_policy_t *policy, FSIZE_t capacity);
+extern FRESULT log_append(log_t *log, const void *data, UINT len, bool event);
+extern FRESULT log_poll(log_t *log);
+extern FRESULT log_flush(log_t *log);
+extern FRESULT log_close(log_t *log);
+
+// Para leitores em outro core: name e is_open só podem ser lidos por aqui
+extern FRESULT log_current_file(log_t *log, char name[LOG_NAME_SIZE], bool flush);
+
+// Leitura incremental (custo constante, independe do tamanho do arquivo)
+extern FRESULT log_read_tail(log_t *log, UINT n, void *out, UINT out_size, UINT *br);
+extern FRESULT log_read_from(log_t *log, FSIZE_t offset, void *out, UINT out_size, UINT *br);
+
+// Consulta por hora UTC no arquivo aberto: busca binária no .IDX e varredura
+// limitada a partir da entrada anterior a from_s
+extern FRESULT log_query_time(log_t *log, uint32_t from_s, uint32_t to_s, log_query_emit_t emit, void *ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef SPI_BUS_H
+#define SPI_BUS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "pico/stdlib.h"
+#include "hardware/spi.h"
+
+// Gerenciador do barramento SPI compartilhado (ex.: display ST7789 + SD Card no spi0).
+// O periférico é inicializado uma única vez; cada dispositivo guarda o próprio
+// baud/formato, que é recarregado no periférico apenas quando o dispositivo ativo
+// muda. Transações são serializadas por mutex (seguro entre core0 e core1).
+
+#define SPI_BUS_NO_PIN 0xFFu // Pino não usado (ex.: display sem MISO)
+
+typedef struct {
+    spi_inst_t *spi;
+    uint cs_pin;      // Chip Select (ativo em nível baixo)
+    uint baud_hz;     // Baud efetivo, após o arredondamento dos divisores
+    uint32_t cr0;     // SSPCR0 já calculado (bits por palavra, CPOL/CPHA, SCR)
+    uint32_t cpsr;    // SSPCPSR já calculado (prescaler)
+} spi_device_t;
+
+extern void spi_bus_init(spi_inst_t *spi, uint sck_pin, uint mosi_pin, uint miso_pin);
+extern void spi_device_init(spi_device_t *dev, spi_inst_t *spi, uint cs_pin, uint baud_hz,
+                            uint data_bits, spi_cpol_t cpol, spi_cpha_t cpha);
+extern void spi_device_set_baud(spi_device_t *dev, uint baud_hz);
+
+// Trava o barramento e aplica o baud/formato do dispositivo (sem mexer no CS)
+extern void spi_device_acquire(spi_device_t *dev);
+extern void spi_device_release(spi_device_t *dev);
+
+// acquire + CS baixo / CS alto + release
+extern void spi_device_select(spi_device_t *dev);
+extern void spi_device_deselect(spi_device_t *dev);
+
+#endif
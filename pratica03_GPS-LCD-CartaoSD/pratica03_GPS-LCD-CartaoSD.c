@@ -2,22 +2,29 @@
 #include "st7789.h"
 #include "colors.h"
 #include "sd_card.h"
+#include "log_service.h"  // Contadores do serviço de log no core1
+#include "flash_store.h"  // Contadores do estágio na flash
+#include "sd_diskio.h"    // Estatísticas de latência do cartão
+#include "time_service.h" // Hora UTC (GPS) para a releitura por intervalo
 
 #include <stdio.h>          // Funções de entrada/saída (printf)
-#include <string.h>         // Manipulação de strings (strtok, strncmp)
 #include "pico/stdlib.h"    // SDK da Raspberry Pi Pico
 
 
+#define SD_STATS_INTERVAL_MS 60000 // Intervalo do relatório de latências do SD
+#define SD_READBACK_RECORDS 4      // Sem hora: registros do fim do arquivo relidos no relatório
+
 // Variáveis globais
-static double last_lat = 0.0;  // Armazena a última latitude válida
-static double last_lon = 0.0;  // Armazena a última longitude válida  
-static bool have_fix = false;  // Flag: true quando GPS tem sinal válido
+static gps_fix_t fix;  // Posição, qualidade e hora montadas das sentenças NMEA (fix.valid: já teve sinal)
 
 
 int main() {
     stdio_init_all();  // Inicializa stdio (USB serial para printf)
     
     // ### Inicialização do GPS ###
+    // Estouros da FIFO da UART são avisados à flash, que conta os causados pelos
+    // seus travamentos do core0 (ver flash_store_dump)
+    gps_uart_set_overrun_hook(flash_store_note_loss);
     setup_gps();
     // ### Inicialização do display ST7789 ###
     st7789_init(); 
@@ -30,8 +37,6 @@ int main() {
     // #########################
 
     
-    char line[128];    // Buffer para acumular uma linha NMEA (até 127 chars + \0)
-    int idx = 0;       // Índice atual no buffer
     absolute_time_t last_print = get_absolute_time();  // Timestamp último print
     
     printf("Iniciando leitura GPS");  // Mensagem inicial
@@ -44,69 +49,56 @@ int main() {
     draw_centered_text("da Posicao", 80, COLOR_BLUE, COLOR_WHITE, 3);
     
     while (1) {
-        // Processa todos os caracteres disponíveis na UART
-        while (uart_is_readable(UART_ID)) {
-            char c = uart_getc(UART_ID);  // Lê um caractere
-            
-            if (c == '\r') continue;  // Ignora carriage return (\r)
-            
-            if (c == '\n') {  // Fim de linha encontrado
-                line[idx] = '\0';  // Termina string com null
-                
-                // Faz cópia porque strtok modifica a string original
-                char copy[128];
-                strncpy(copy, line, sizeof(copy));
-                copy[127] = '\0';  // Garante terminação
-                
-                // Identifica tipo de sentença
-                if (strncmp(copy, "$GPRMC", 6) == 0) { // Se é RMC, chama parse_gprmc
-                    double lat, lon;
-                    // Se o parser retornar true, atualiza a última posição e marca have_fix = true
-                    if (parse_gprmc(copy, &lat, &lon)) {
-                        last_lat = lat; last_lon = lon; have_fix = true;
-                    }
-                } else if (strncmp(copy, "$GPGGA", 6) == 0) { // Se é GGA, chama parse_gpgga
-                    double lat, lon;
-                    // Se o parser retornar true, atualiza a última posição e marca have_fix = true
-                    if (parse_gpgga(copy, &lat, &lon)) {
-                        last_lat = lat; last_lon = lon; have_fix = true;
-                    }
-                }
-                
-                idx = 0;  // Reseta buffer para próxima linha
-            } else {
-                // Adiciona caractere ao buffer, prevenindo overflow
-                if (idx < 127) line[idx++] = c;
-                else idx = 0;  // Overflow --> descarta linha
-            }
+        // Processa todas as sentenças NMEA já recebidas (a interrupção da UART as
+        // guarda no anel enquanto o laço está ocupado com o SD ou o display)
+        // O despacho é pelo tipo (RMC, GGA, GSA, GSV, VTG, ZDA) de qualquer talker
+        const nmea_sentence_t *s;
+        while ((s = gps_read_sentence()) != NULL) {
+            gps_handle_sentence(s, &fix);
         }
-        
+        // Entre rajadas do GPS o core1 pode apagar a flash sem estourar a FIFO da UART
+        flash_store_allow_erase(gps_uart_quiet_ms());
+
         // Verifica se passaram 1 segundos desde último print
         if (absolute_time_diff_us(last_print, get_absolute_time()) >= 1000000) {
             last_print = get_absolute_time();  // Atualiza timestamp
             
-            if (have_fix) { // Se fix válido, imprime a última lat/lon com 6 casas decimais
+            if (fix.valid) { // Se fix válido, imprime a última lat/lon com 6 casas decimais
                 // Formatação das strings
-                snprintf(buffer_lat, sizeof(buffer_lat), "Latitude: %.6f", last_lat);
-                snprintf(buffer_long, sizeof(buffer_long), "Longitude: %.6f", last_lon);
+                // (ponto flutuante só aqui, para exibição)
+                snprintf(buffer_lat, sizeof(buffer_lat), "Latitude: %.6f", fix.lat / 1e7);
+                snprintf(buffer_long, sizeof(buffer_long), "Longitude: %.6f", fix.lon / 1e7);
 
-                printf("%s | %s\n", buffer_lat, buffer_long);
+                printf("%s | %s | fix %uD, %u/%u satélites, HDOP %u.%02u, %ld.%02ld km/h\n",
+                       buffer_lat, buffer_long, fix.fix_type, fix.sats_used, fix.sats_in_view,
+                       fix.hdop / 100, fix.hdop % 100, (long)(fix.speed_kmh / 100), (long)(fix.speed_kmh % 100));
 
                 // Escreve os dados de localização no Display
                 draw_centered_text(buffer_lat, 130, COLOR_GRAY, COLOR_WHITE, 2);
                 draw_centered_text(buffer_long, 160, COLOR_GRAY, COLOR_WHITE, 2);
 
                 // ### Escreve os dados de localização no sd
-                write_to_sd(last_lat, last_lon);
-                // ### Lendo dados de localização no SD
-                read_from_sd();
+                write_to_sd(fix.lat, fix.lon);
 
             } else { // Caso contrário, avisa que ainda não há fix.
                 printf("Sem fix GPS ainda (aguardando satélites)...\n");
             }
         }
         
-        sleep_ms(10);  // Pequena pausa para reduzir consumo de CPU
+        // Latências do SD, contadores do serviço de log (core1), da flash e da UART do GPS no serial,
+        // e a releitura do cartão: registros do último intervalo pela hora UTC (.IDX) ou, sem
+        // hora, os últimos do arquivo (o que ainda está na flash aparece no relatório seguinte)
+        if (disk_lat_dump_periodic(SD_STATS_INTERVAL_MS)) {
+            log_service_dump();
+            flash_store_dump();
+            gps_uart_dump();
+
+            uint32_t now_s = time_service_unix();
+            if (now_s) read_range_from_sd(now_s - SD_STATS_INTERVAL_MS / 1000, now_s);
+            else read_tail_from_sd(SD_READBACK_RECORDS);
+        }
+
+        sleep_ms(10);  // Pequena pausa para reduzir consumo de CPU (a UART é atendida por interrupção)
     }
     
     return 0;  
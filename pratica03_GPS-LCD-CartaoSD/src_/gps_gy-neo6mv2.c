@@ -1,8 +1,11 @@
 #include "gps_gy-neo6mv2.h"
 #include <stdio.h>          // Funções de entrada/saída (printf)
-#include <string.h>         // Manipulação de strings (strtok, strncmp)
-#include <stdlib.h>         // Funções utilitárias (atof, atoi)
+#include <stdlib.h>         // atoi
+#include <string.h>         // strlen
 #include "hardware/uart.h"  // Controle de UART da Pico
+#include "hardware/irq.h"   // Interrupção de recepção da UART
+#include "hardware/sync.h"  // __dmb
+#include "time_service.h"   // Relógio UTC disciplinado pelo GPS
 
 
 #define BAUD_RATE      9600  // Velocidade padrão do GPS NEO-6M
@@ -10,84 +13,283 @@
 #define UART_RX_PIN    1     // GPIO1 como RX <- conecta ao TX do GPS
 
 
+#define GPS_RX_MASK (GPS_RX_BUF_SIZE - 1)
+#if (GPS_RX_BUF_SIZE & GPS_RX_MASK) != 0
+#error "GPS_RX_BUF_SIZE deve ser potência de 2"
+#endif
+
+// Anel SPSC: head só é escrito pela ISR, tail só pelo laço principal
+static char rx_buf[GPS_RX_BUF_SIZE];
+static volatile uint32_t rx_head = 0;
+static volatile uint32_t rx_tail = 0;
+static gps_uart_stats_t stats;
+
+// Tempos da recepção (só a ISR escreve): início da rajada atual e último byte
+static volatile uint32_t burst_start_us;
+static volatile uint32_t last_rx_us;
+static void (*overrun_hook)(void); // Opcional: avisado de cada estouro da FIFO
+
+static nmea_parser_t nmea; // Tokenizador alimentado pelo anel (só no laço principal)
+
+
+// Esvazia a FIFO da UART no anel. Lê o registrador de dados direto para ver os
+// bits de erro de cada byte (o uart_getc os descarta).
+static void gps_uart_irq(void) {
+    uart_hw_t *hw = uart_get_hw(UART_ID);
+    uint32_t now = time_us_32();
+    if (now - last_rx_us >= GPS_GAP_MS * 1000u) burst_start_us = now;
+    last_rx_us = now;
+
+    while (uart_is_readable(UART_ID)) {
+        uint32_t dr = hw->dr;
+        if (dr & UART_UARTDR_OE_BITS) {
+            stats.fifo_overruns++;
+            if (overrun_hook) overrun_hook();
+        }
+        if (dr & (UART_UARTDR_FE_BITS | UART_UARTDR_PE_BITS | UART_UARTDR_BE_BITS)) {
+            stats.line_errors++;
+            continue;
+        }
+        stats.rx_bytes++;
+
+        uint32_t h = rx_head;
+        uint32_t used = h - rx_tail;
+        if (used >= GPS_RX_BUF_SIZE) {
+            stats.ring_overflows++;
+            continue;
+        }
+        rx_buf[h & GPS_RX_MASK] = (char)dr;
+        __dmb(); // byte gravado antes de publicar o novo head
+        rx_head = h + 1;
+        if (used + 1 > stats.high_watermark) stats.high_watermark = used + 1;
+    }
+}
+
 // Configura hardware UART
 void setup_gps(){
     // Configura hardware UART
+    nmea_init(&nmea);
     uart_init(UART_ID, BAUD_RATE);  // Inicializa UART com baud rate
     gpio_set_function(UART_TX_PIN, GPIO_FUNC_UART);  // Configura pino como UART
     gpio_set_function(UART_RX_PIN, GPIO_FUNC_UART);
-}
 
-// Conversão de coordenadas
-double nmea_to_decimal(const char *s) { // NMEA fornece latitude/longitude como ddmm.mmmm (ou dddmm.mmmm para longitude)
-    double v = atof(s);         // Converte string para número 
-    int deg = (int)(v / 100.0); // Extrai graus
-    double minutes = v - (deg * 100.0); // Extrai minutos
-    return deg + minutes / 60.0; // Converte para decimal
+    // Recepção por interrupção (FIFO ligada: a ISR roda a cada ~4 bytes ou no timeout)
+    uart_set_fifo_enabled(UART_ID, true);
+    irq_set_exclusive_handler(UART_IRQ_NUM(UART_ID), gps_uart_irq);
+    irq_set_enabled(UART_IRQ_NUM(UART_ID), true);
+    uart_set_irq_enables(UART_ID, true, false); // RX sim, TX não
 }
 
 
-// Parser da sentença $GPRMC
-bool parse_gprmc(char *sentence, double *lat_out, double *lon_out) {
-    char *fields[20];  // Array para armazenar os campos da sentença
-    int n = 0;         // Contador de campos
-    
-    // Divide a string usando vírgulas como delimitadores
-    char *tok = strtok(sentence, ",");
-    while (tok != NULL && n < 20) {
-        fields[n++] = tok;  // Armazena cada campo no array
-        tok = strtok(NULL, ",");  // Pega próximo campo
+// Próxima sentença NMEA completa do anel, ou NULL se ainda não chegou. Cada
+// byte passa uma vez pelo tokenizador; a sentença fica válida até a próxima
+// chamada. Nunca bloqueia.
+const nmea_sentence_t *gps_read_sentence(void) {
+    while (rx_tail != rx_head) {
+        __dmb(); // lê o byte só depois de ver o head que o publicou
+        char c = rx_buf[rx_tail & GPS_RX_MASK];
+        rx_tail = rx_tail + 1;
+
+        const nmea_sentence_t *s = nmea_feed(&nmea, c);
+        if (s) return s;
     }
-    
-    if (n < 7) return false;  // Sentença muito curta -> inválida
-    // --> fields: 0=$GPRMC 1=time 2=status 3=lat 4=N/S 5=lon 6=E/W
-    // fields[2] = status ('A' = ativo/válido, 'V' = inválido)
-    if (fields[2][0] != 'A') return false;
-    
-    // Verifica se campos de lat/lon não estão vazios
-    if (fields[3][0] == '\0' || fields[5][0] == '\0') return false;
-    
-    // Converte e aplica sinal (N/S, E/W)
-    double lat = nmea_to_decimal(fields[3]);
-    if (fields[4][0] == 'S') lat = -lat;  // Sul --> negativo
-    
-    double lon = nmea_to_decimal(fields[5]);
-    if (fields[6][0] == 'W') lon = -lon;  // Oeste --> negativo
-    
-    // Devolve os resultados por ponteiro e indica sucesso
-    *lat_out = lat;
-    *lon_out = lon;
+    return NULL;
+}
+
+// Define o gancho de estouro (antes de setup_gps ou com a interrupção desligada)
+void gps_uart_set_overrun_hook(void (*hook)(void)) {
+    overrun_hook = hook;
+}
+
+// Por quantos ms o core0 pode ficar travado (ex.: apagamento da flash) sem
+// perder bytes: do fim de uma rajada até pouco antes da próxima; 0 no meio dela
+uint32_t gps_uart_quiet_ms(void) {
+    uint32_t start = burst_start_us; // antes de last_rx_us: uma rajada nova no meio
+    uint32_t last = last_rx_us;      // das leituras aparece como linha ativa
+    uint32_t now = time_us_32();
+
+    if (stats.rx_bytes == 0 || now - last >= GPS_LOST_MS * 1000u) return GPS_EPOCH_MS;
+    if (now - last < GPS_GAP_MS * 1000u) return 0;
+
+    uint32_t elapsed_ms = (now - start) / 1000u;
+    if (elapsed_ms + GPS_MARGIN_MS >= GPS_EPOCH_MS) return 0;
+    return GPS_EPOCH_MS - GPS_MARGIN_MS - elapsed_ms;
+}
+
+void gps_uart_get_stats(gps_uart_stats_t *out) {
+    *out = stats;
+    out->nmea = nmea.stats;
+}
+
+void gps_uart_dump(void) {
+    printf("GPS UART: %lu bytes, %lu perdidos (anel cheio), %lu estouros da FIFO, "
+           "%lu erros de linha, pico do anel %lu/%u\n",
+           (unsigned long)stats.rx_bytes, (unsigned long)stats.ring_overflows,
+           (unsigned long)stats.fifo_overruns, (unsigned long)stats.line_errors,
+           (unsigned long)stats.high_watermark, GPS_RX_BUF_SIZE);
+    printf("GPS NMEA: %lu sentenças, %lu checksums errados, %lu truncadas, %lu longas demais\n",
+           (unsigned long)nmea.stats.sentences, (unsigned long)nmea.stats.checksum_errors,
+           (unsigned long)nmea.stats.truncated, (unsigned long)nmea.stats.overflows);
+}
+
+// Grava a hora no fix e ajusta o relógio UTC (false se a data for inválida)
+static bool gps_set_time(gps_fix_t *fix, const utc_time_t *utc) {
+    if (utc->month < 1 || utc->month > 12 || utc->day < 1 || utc->day > 31) return false;
+    fix->utc = *utc;
+    fix->utc_valid = true;
+    time_service_set(utc);
+    return true;
+}
+
+
+// ==========================
+// Parsers por tipo de sentença (campo 0 sem o talker: "GPRMC", "GNRMC" -> RMC)
+// ==========================
+
+// RMC: 1=hora 2=status 3=lat 4=N/S 5=lon 6=E/W 7=velocidade(nós) 8=rumo 9=data(ddmmyy)
+static bool parse_rmc(const nmea_sentence_t *s, gps_fix_t *fix) {
+    if (s->count < 10) return false;  // Sentença muito curta -> inválida
+    // campo 2 = status ('A' = ativo/válido, 'V' = inválido)
+    if (nmea_field(s, 2)[0] != 'A') return false;
+
+    // Converte e aplica sinal (Sul/Oeste --> negativo); campos vazios são rejeitados
+    int32_t lat, lon;
+    if (!nmea_to_e7(nmea_field(s, 3), nmea_field(s, 4)[0], 90, &lat)) return false;
+    if (!nmea_to_e7(nmea_field(s, 5), nmea_field(s, 6)[0], 180, &lon)) return false;
+    fix->lat = lat;
+    fix->lon = lon;
+    fix->valid = true;
+
+    // Só confia na hora com posição válida
+    utc_time_t utc;
+    if (nmea_time(nmea_field(s, 1), &utc) && nmea_date(nmea_field(s, 9), &utc)) gps_set_time(fix, &utc);
+    return true;
+}
+
+// GGA: 1=hora 2=lat 3=N/S 4=lon 5=E/W 6=qualidade 7=satélites 8=HDOP 9=altitude(m)
+static bool parse_gga(const nmea_sentence_t *s, gps_fix_t *fix) {
+    if (s->count < 10) return false;
+    // campo 6 = qualidade do fix (0 = inválido, 1 = GPS, 2 = DGPS)
+    fix->quality = (uint8_t)atoi(nmea_field(s, 6));
+    fix->sats_used = (uint8_t)atoi(nmea_field(s, 7));
+    if (fix->quality == 0) return false;  // Sem fix válido
+
+    int32_t lat, lon, v;
+    if (!nmea_to_e7(nmea_field(s, 2), nmea_field(s, 3)[0], 90, &lat)) return false;
+    if (!nmea_to_e7(nmea_field(s, 4), nmea_field(s, 5)[0], 180, &lon)) return false;
+    fix->lat = lat;
+    fix->lon = lon;
+    fix->valid = true;
+    if (nmea_to_fixed(nmea_field(s, 8), 2, &v)) fix->hdop = (uint16_t)v;
+    if (nmea_to_fixed(nmea_field(s, 9), 1, &v)) fix->alt_dm = v;
     return true;
 }
 
+// GSA: 1=modo(M/A) 2=tipo(1=sem fix, 2=2D, 3=3D) 3..14=PRNs 15=PDOP 16=HDOP 17=VDOP
+static bool parse_gsa(const nmea_sentence_t *s, gps_fix_t *fix) {
+    if (s->count < 18) return false;
+    int32_t pdop, hdop, vdop;
+    if (!nmea_to_fixed(nmea_field(s, 15), 2, &pdop) ||
+        !nmea_to_fixed(nmea_field(s, 16), 2, &hdop) ||
+        !nmea_to_fixed(nmea_field(s, 17), 2, &vdop)) return false;
+    fix->fix_type = (uint8_t)atoi(nmea_field(s, 2));
+    fix->pdop = (uint16_t)pdop;
+    fix->hdop = (uint16_t)hdop;
+    fix->vdop = (uint16_t)vdop;
+    return true;
+}
+
+// GSV: 1=total de mensagens 2=número da mensagem 3=satélites visíveis, depois
+// grupos de 4 campos por satélite (PRN, elevação, azimute, SNR). Cada talker
+// (GP, GL, GA, ...) manda o seu ciclo; o fix soma as constelações.
+#define GSV_TALKERS 5
+static uint8_t gsv_in_view[GSV_TALKERS];
+static uint8_t gsv_snr[GSV_TALKERS];
+
+static int gsv_talker(const char *addr) {
+    switch (addr[1]) {
+    case 'P': return 0; // GPS
+    case 'L': return 1; // GLONASS
+    case 'A': return 2; // Galileo
+    case 'B': case 'D': return 3; // BeiDou (GB/BD)
+    default: return 4;
+    }
+}
+
+static bool parse_gsv(const nmea_sentence_t *s, gps_fix_t *fix) {
+    if (s->count < 4) return false;
+    int t = gsv_talker(nmea_field(s, 0));
+    if (atoi(nmea_field(s, 2)) == 1) gsv_snr[t] = 0; // primeira mensagem do ciclo
+    gsv_in_view[t] = (uint8_t)atoi(nmea_field(s, 3));
+
+    for (uint8_t f = 7; f < s->count; f += 4) { // SNR de cada satélite (vazio: não rastreado)
+        int snr = atoi(nmea_field(s, f));
+        if (snr > gsv_snr[t]) gsv_snr[t] = (uint8_t)snr;
+    }
 
-// Parser da sentença $GPGGA
-bool parse_gpgga(char *sentence, double *lat_out, double *lon_out) {
-    // Estrutura similar ao GPRMC mas com campos diferentes
-    char *fields[20];
-    int n = 0;
-    char *tok = strtok(sentence, ",");
-    while (tok != NULL && n < 20) {
-        fields[n++] = tok;
-        tok = strtok(NULL, ",");
+    fix->sats_in_view = 0;
+    fix->snr_max = 0;
+    for (int i = 0; i < GSV_TALKERS; i++) {
+        fix->sats_in_view += gsv_in_view[i];
+        if (gsv_snr[i] > fix->snr_max) fix->snr_max = gsv_snr[i];
     }
-    
-    if (n < 7) return false;
-    // --> GPGGA fields: 0=$GPGGA 1=time 2=lat 3=N/S 4=lon 5=E/W 6=fixQuality (0=invalid)
-    // fields[6] = qualidade do fix (0 = inválido, 1 = GPS, 2 = DGPS)
-    int fix = atoi(fields[6]);
-    if (fix == 0) return false;  // Sem fix válido
-    
-    if (fields[2][0] == '\0' || fields[4][0] == '\0') return false;
-    
-    // Conversão igual ao GPRMC mas com índices diferentes
-    double lat = nmea_to_decimal(fields[2]);
-    if (fields[3][0] == 'S') lat = -lat;
-    
-    double lon = nmea_to_decimal(fields[4]);
-    if (fields[5][0] == 'W') lon = -lon;
-    
-    *lat_out = lat;
-    *lon_out = lon;
     return true;
-}
\ No newline at end of file
+}
+
+// VTG: 1=rumo verdadeiro 2=T 3=rumo magnético 4=M 5=velocidade(nós) 6=N 7=velocidade(km/h) 8=K
+static bool parse_vtg(const nmea_sentence_t *s, gps_fix_t *fix) {
+    if (s->count < 9) return false;
+    int32_t speed, course;
+    if (!nmea_to_fixed(nmea_field(s, 7), 2, &speed)) return false;
+    fix->speed_kmh = speed;
+    // Parado, o receptor deixa o rumo vazio: mantém o último
+    if (nmea_to_fixed(nmea_field(s, 1), 2, &course)) fix->course = (uint16_t)course;
+    return true;
+}
+
+// ZDA: 1=hora 2=dia 3=mês 4=ano(4 dígitos) 5,6=fuso local
+static bool parse_zda(const nmea_sentence_t *s, gps_fix_t *fix) {
+    if (s->count < 5) return false;
+    utc_time_t utc;
+    if (!nmea_time(nmea_field(s, 1), &utc)) return false;
+    int year = atoi(nmea_field(s, 4));
+    if (year < 2000) return false; // vazio antes de o receptor conhecer a data
+    utc.year = (uint16_t)year;
+    utc.month = (uint8_t)atoi(nmea_field(s, 3));
+    utc.day = (uint8_t)atoi(nmea_field(s, 2));
+    return gps_set_time(fix, &utc);
+}
+
+
+// ==========================
+// Despacho pelo tipo da sentença (ignora o talker: GP, GN, GL, ...)
+// ==========================
+#define NMEA_TYPE(a, b, c) ((uint32_t)(a) << 16 | (uint32_t)(b) << 8 | (uint32_t)(c))
+
+typedef struct {
+    uint32_t type;                                            // NMEA_TYPE das 3 letras
+    bool (*parse)(const nmea_sentence_t *s, gps_fix_t *fix);
+} gps_handler_t;
+
+static const gps_handler_t handlers[] = {
+    { NMEA_TYPE('R', 'M', 'C'), parse_rmc },
+    { NMEA_TYPE('G', 'G', 'A'), parse_gga },
+    { NMEA_TYPE('G', 'S', 'A'), parse_gsa },
+    { NMEA_TYPE('G', 'S', 'V'), parse_gsv },
+    { NMEA_TYPE('V', 'T', 'G'), parse_vtg },
+    { NMEA_TYPE('Z', 'D', 'A'), parse_zda },
+};
+
+// Atualiza fix com a sentença. Endereço de 5 letras: 2 do talker + 3 do tipo;
+// sentenças proprietárias ($PUBX...) e tipos sem parser são ignorados. Devolve
+// true se a sentença trouxe dados válidos para o fix.
+bool gps_handle_sentence(const nmea_sentence_t *s, gps_fix_t *fix) {
+    const char *addr = nmea_field(s, 0);
+    if (addr[0] == 'P' || strlen(addr) != 5) return false;
+
+    uint32_t type = NMEA_TYPE(addr[2], addr[3], addr[4]);
+    for (size_t i = 0; i < sizeof(handlers) / sizeof(handlers[0]); i++) {
+        if (handlers[i].type == type) return handlers[i].parse(s, fix);
+    }
+    return false;
+}
@@ -0,0 +1,48 @@
+#include "log_record.h"
+#include <string.h> // memcpy
+
+_Static_assert(sizeof(log_record_t) == LOG_REC_SIZE, "log_record_t deve ter exatamente LOG_REC_SIZE bytes");
+
+
+// CRC-16/CCITT (polinômio 0x1021, valor inicial 0xFFFF), tabela de 16 entradas
+// processando 4 bits por vez: pouca flash e poucos ciclos no Cortex-M0+
+static const uint16_t crc16_nibble[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+};
+
+uint16_t log_crc16(const void *data, size_t len) {
+    return log_crc16_update(0xFFFF, data, len);
+}
+
+// Continua um CRC já iniciado (dados em partes não contíguas)
+uint16_t log_crc16_update(uint16_t crc, const void *data, size_t len) {
+    const uint8_t *p = (const uint8_t *)data;
+    while (len--) {
+        crc = (uint16_t)((crc << 4) ^ crc16_nibble[(crc >> 12) ^ (*p >> 4)]);
+        crc = (uint16_t)((crc << 4) ^ crc16_nibble[(crc >> 12) ^ (*p & 0x0F)]);
+        p++;
+    }
+    return crc;
+}
+
+// Monta um registro completo, já com o CRC calculado
+void log_record_make(log_record_t *rec, uint8_t type, uint32_t t_ms, int32_t a, int32_t b) {
+    rec->magic = LOG_REC_MAGIC;
+    rec->type = type;
+    rec->crc = 0;
+    rec->t_ms = t_ms;
+    rec->a = a;
+    rec->b = b;
+    rec->crc = log_crc16(rec, sizeof(*rec));
+}
+
+// Confere marcador e CRC de um registro lido do cartão
+bool log_record_valid(const log_record_t *rec) {
+    if (rec->magic != LOG_REC_MAGIC) return false;
+
+    log_record_t tmp;
+    memcpy(&tmp, rec, sizeof(tmp));
+    tmp.crc = 0;
+    return log_crc16(&tmp, sizeof(tmp)) == rec->crc;
+}
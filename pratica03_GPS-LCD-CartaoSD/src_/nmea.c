@@ -0,0 +1,210 @@
+#include "nmea.h"
+#include <stddef.h> // NULL
+#include <string.h> // memset
+
+
+void nmea_init(nmea_parser_t *p) {
+    p->state = NMEA_WAIT_START;
+    p->len = 0;
+    memset(&p->stats, 0, sizeof(p->stats));
+    p->sentence.count = 0;
+}
+
+
+// Começa uma sentença nova (campo 0 em buf[0])
+static void nmea_start(nmea_parser_t *p) {
+    p->state = NMEA_BODY;
+    p->len = 0;
+    p->sum = 0;
+    p->digits = 0;
+    p->sentence.field[0] = 0;
+    p->sentence.count = 1;
+}
+
+static void nmea_reject(nmea_parser_t *p, uint32_t *counter) {
+    (*counter)++;
+    p->state = NMEA_WAIT_START;
+}
+
+// Valor de um dígito hexadecimal (maiúsculo ou minúsculo), -1 se não for
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+
+// Consome um byte. Devolve a sentença quando o fim de linha a completa com o
+// checksum correto, ou NULL. A sentença fica válida até a próxima chamada.
+const nmea_sentence_t *nmea_feed(nmea_parser_t *p, char c) {
+    // '$' sempre reinicia: ressincroniza após bytes perdidos na UART
+    if (c == '$') {
+        if (p->state != NMEA_WAIT_START) p->stats.truncated++;
+        nmea_start(p);
+        return NULL;
+    }
+
+    switch (p->state) {
+    case NMEA_WAIT_START:
+        return NULL;
+
+    case NMEA_BODY:
+        if (c == '*') {
+            p->sentence.buf[p->len] = '\0'; // sempre cabe: o teste abaixo reserva o \0
+            p->state = NMEA_CHECKSUM;
+            return NULL;
+        }
+        if (c == '\r' || c == '\n') { // sem checksum: linha cortada
+            nmea_reject(p, &p->stats.truncated);
+            return NULL;
+        }
+        if (p->len >= NMEA_MAX_LEN - 1) {
+            nmea_reject(p, &p->stats.overflows);
+            return NULL;
+        }
+        p->sum ^= (uint8_t)c;
+        if (c == ',') {
+            if (p->sentence.count >= NMEA_MAX_FIELDS) {
+                nmea_reject(p, &p->stats.overflows);
+                return NULL;
+            }
+            p->sentence.buf[p->len++] = '\0';
+            p->sentence.field[p->sentence.count++] = p->len;
+            return NULL;
+        }
+        p->sentence.buf[p->len++] = c;
+        return NULL;
+
+    case NMEA_CHECKSUM: {
+        int v = hex_value(c);
+        if (v < 0) { // fim de linha (ou lixo) antes dos dois dígitos
+            nmea_reject(p, &p->stats.truncated);
+            return NULL;
+        }
+        // Confere um dígito por vez: o mais significativo primeiro
+        int expected = p->digits == 0 ? p->sum >> 4 : p->sum & 0x0F;
+        if (v != expected) {
+            nmea_reject(p, &p->stats.checksum_errors);
+            return NULL;
+        }
+        if (++p->digits == 2) p->state = NMEA_END;
+        return NULL;
+    }
+
+    case NMEA_END:
+        if (c == '\r') return NULL;
+        if (c != '\n') {
+            nmea_reject(p, &p->stats.truncated);
+            return NULL;
+        }
+        p->state = NMEA_WAIT_START;
+        p->stats.sentences++;
+        return &p->sentence;
+    }
+    return NULL;
+}
+
+
+// Conversão de coordenadas sem ponto flutuante. NMEA fornece latitude/longitude
+// como ddmm.mmmmm (dddmm.mmmmm para longitude); o resultado sai em inteiros de
+// 1e-7 grau, arredondado (1e-5 minuto = 1,67e-7 grau: nada se perde na escala).
+// hemi é 'N'/'S' ou 'E'/'W'; false se o campo não for uma coordenada válida.
+bool nmea_to_e7(const char *s, char hemi, int32_t max_deg, int32_t *out) {
+    uint32_t whole = 0; // ddmm inteiro
+    int n = 0;
+    for (; *s >= '0' && *s <= '9'; s++, n++) {
+        if (n >= 5) return false;
+        whole = whole * 10 + (uint32_t)(*s - '0');
+    }
+    if (n < 3) return false;
+
+    // Minutos em 1e-7 minuto: parte inteira + até 7 casas (as demais são ignoradas)
+    uint32_t min_e7 = (whole % 100) * 10000000u;
+    if (*s == '.') {
+        uint32_t scale = 1000000u;
+        for (s++; *s >= '0' && *s <= '9'; s++) {
+            min_e7 += (uint32_t)(*s - '0') * scale;
+            scale /= 10;
+        }
+    }
+    if (*s != '\0' || whole % 100 >= 60) return false;
+
+    uint32_t deg = whole / 100;
+    if (deg > (uint32_t)max_deg) return false;
+    int32_t v = (int32_t)(deg * 10000000u + (min_e7 + 30) / 60); // grau = minuto / 60
+    if (v > max_deg * 10000000) return false;
+
+    if (hemi == 'S' || hemi == 'W') v = -v;
+    else if (hemi != 'N' && hemi != 'E') return false;
+    *out = v;
+    return true;
+}
+
+
+// Número decimal de campo NMEA ("1.25") em inteiro escalado por 10^decimals
+// (1.25 com decimals = 2 -> 125), sem ponto flutuante. false se vazio ou inválido.
+bool nmea_to_fixed(const char *s, int decimals, int32_t *out) {
+    bool neg = *s == '-';
+    if (neg) s++;
+    if (*s < '0' || *s > '9') return false;
+
+    int32_t v = 0;
+    for (; *s >= '0' && *s <= '9'; s++) {
+        if (v > 1000000) return false; // evita estouro com as casas a seguir
+        v = v * 10 + (*s - '0');
+    }
+    int frac = 0;
+    if (*s == '.') {
+        for (s++; *s >= '0' && *s <= '9'; s++) {
+            if (frac < decimals) {
+                v = v * 10 + (*s - '0');
+                frac++;
+            }
+        }
+    }
+    if (*s != '\0') return false;
+    for (; frac < decimals; frac++) v *= 10;
+    *out = neg ? -v : v;
+    return true;
+}
+
+// Dois dígitos ASCII em número; -1 se algum não for dígito
+static int two_digits(const char *p) {
+    if (p[0] < '0' || p[0] > '9' || p[1] < '0' || p[1] > '9') return -1;
+    return (p[0] - '0') * 10 + (p[1] - '0');
+}
+
+// Hora hhmmss[.ss] do campo t em utc (a data é preenchida por nmea_date).
+// false com campo vazio, curto, com algo que não seja dígito ou fora da faixa.
+bool nmea_time(const char *t, utc_time_t *utc) {
+    int hour = two_digits(t);
+    int min = hour < 0 ? -1 : two_digits(t + 2);
+    int sec = min < 0 ? -1 : two_digits(t + 4);
+    if (sec < 0 || hour > 23 || min > 59 || sec > 60) return false;
+
+    const char *p = t + 6;
+    if (*p == '.') {
+        for (p++; *p >= '0' && *p <= '9'; p++) {}
+    }
+    if (*p != '\0') return false;
+
+    utc->hour = (uint8_t)hour;
+    utc->min = (uint8_t)min;
+    utc->sec = (uint8_t)sec;
+    return true;
+}
+
+// Data ddmmyy do campo d em utc (ano 20yy). Só confere o formato: a faixa de
+// mês e dia fica com quem usa a data.
+bool nmea_date(const char *d, utc_time_t *utc) {
+    int day = two_digits(d);
+    int month = day < 0 ? -1 : two_digits(d + 2);
+    int year = month < 0 ? -1 : two_digits(d + 4);
+    if (year < 0 || d[6] != '\0') return false;
+
+    utc->year = (uint16_t)(2000 + year);
+    utc->month = (uint8_t)month;
+    utc->day = (uint8_t)day;
+    return true;
+}
@@ -3,7 +3,14 @@
 #include <string.h> // Funções de manipulação de strings (
 #include "pico/stdlib.h" // Biblioteca padrão do Raspberry Pi Pico
 #include "hardware/spi.h" // Driver SPI do Pico
+#include "spi_bus.h" // Barramento SPI compartilhado (display + SD)
 #include "ff.h" // biblioteca FatFs para sistemas de arquivos
+#include "sd_logger.h" // Sessão de log persistente (volume montado e arquivo aberto)
+#include "log_record.h" // Registros binários de tamanho fixo com CRC
+#include "log_codec.h" // Quadros comprimidos (um por setor)
+#include "log_service.h" // Gravação no core1 (write-behind)
+#include "flash_store.h" // Estágio na flash interna antes do SD
+#include "time_service.h" // Relógio UTC (GPS) para get_fattime e nomes dos arquivos
 
 
 // SPI Pins
@@ -12,33 +19,190 @@
 #define SD_PIN_SCK  18 // SCK  - Clock - sinal de sincronização
 #define SD_PIN_MOSI 19 // MOSI - Master Out Slave In - dados do Pico para SD card
 
-// Nome do arquivo no SD Card
-#define FILENAME "locali.txt"
+// Diretório dos arquivos de log no SD Card (um arquivo AAMMDDnn.BIN por data)
+#define LOG_DIR "LOCALI"
+#define LOG_MAX_FILE_BYTES (1024 * 1024) // Tamanho máximo de cada arquivo (65536 registros crus; comprimidos, bem mais)
+#define LOG_RETENTION_DAYS 30 // Arquivos com data mais antiga que isso são apagados
+#define LOG_PRUNE_INTERVAL_MS (60 * 60 * 1000) // Varredura do diretório de logs a cada 1 h
 
 
-// Variáveis globais do sistema de arquivos
-FATFS fs;  // Estrutura que representa o sistema de arquivos FAT
-FIL fil;   // Estrutura que representa um arquivo aberto
+// Sessão de log usada por write_to_sd. Leituras usam um FIL próprio (por chamada),
+// então podem rodar em outro core enquanto o logger grava (FatFs reentrante); o
+// nome do arquivo aberto é lido só por log_current_file, sob o lock do logger.
+static log_t sd_log;
 
+// Última âncora de hora (LOG_REC_TIME_SYNC) que chegou ao sink, na ordem do
+// fluxo; só o core1 usa (type 0: nenhuma ainda)
+static log_record_t last_sync;
 
-// Função de Timestamp (get_fattime)
+#define TIME_SYNC_INTERVAL_MS (10 * 60 * 1000) // Nova âncora no fluxo a cada 10 min (deriva do cristal)
+
+// Política de sincronização: registros periódicos, f_sync a cada 5 s ou 4 KiB (256 registros).
+// Posições consecutivas quase iguais: comprimidas ocupam de 6 a 8 vezes menos no cartão.
+static const log_policy_t sd_log_policy = {
+    .sync_interval_ms = 5000,
+    .sync_bytes = 4096,
+    .sync_on_event = false,
+    .compress = true,
+};
+
+
+// Função de Timestamp (get_fattime): hora do GPS quando disponível
 DWORD get_fattime(void) {
-    return ((DWORD)(2025 - 1980) << 25) // Ano desde 1980 (2025-1980 = 45)
-         | ((DWORD)7 << 21) // Mês (julho)
-         | ((DWORD)9 << 16) // Dia (9)
-         | ((DWORD)16 << 11) // Hora (16h)
-         | ((DWORD)45 << 5) // Minuto (45)
-         | ((DWORD)0 >> 1); // Segundos/2 (0)
+    return time_service_fattime();
+}
+
+
+// Abre a sessão de log (se ainda não estiver aberta)
+static bool open_log_sd(void) {
+    if (sd_log.is_open) return true;
+
+    FRESULT fr = log_open_rotating(&sd_log, LOG_DIR, &sd_log_policy, LOG_MAX_FILE_BYTES);
+    if (fr != FR_OK) {
+        printf("\nFalha ao abrir sessão de log no SD Card (erro: %d)\n", fr);
+        return false;
+    }
+    return true;
+}
+
+
+// Escreve um valor em 1e-7 grau como texto decimal, sem ponto flutuante
+static void print_e7(int32_t v) {
+    uint32_t u = v < 0 ? (uint32_t)-(int64_t)v : (uint32_t)v;
+    printf("%s%lu.%07lu", v < 0 ? "-" : "", (unsigned long)(u / 10000000u), (unsigned long)(u % 10000000u));
+}
+
+// Imprime um registro lido do cartão (conferência/depuração)
+static void print_record(const log_record_t *rec) {
+    if (!log_record_valid(rec)) {
+        printf("[registro corrompido]\n");
+        return;
+    }
+    if (rec->type == LOG_REC_GPS_POS) {
+        printf("[%lu ms] Lat: ", (unsigned long)rec->t_ms);
+        print_e7(rec->a);
+        printf(", Lon: ");
+        print_e7(rec->b);
+        printf("\n");
+    } else if (rec->type == LOG_REC_TIME_SYNC) {
+        printf("[%lu ms] Hora UTC (Unix): %lu\n", (unsigned long)rec->t_ms, (unsigned long)(uint32_t)rec->a);
+    } else {
+        printf("[%lu ms] tipo %u\n", (unsigned long)rec->t_ms, rec->type);
+    }
+}
+
+
+static void print_record_cb(const log_record_t *rec, void *ctx) {
+    (void)ctx;
+    print_record(rec);
+}
+
+static void print_query_cb(const log_record_t *rec, uint32_t unix_s, void *ctx) {
+    (void)ctx;
+    printf("(UTC %lu) ", (unsigned long)unix_s);
+    print_record(rec);
+}
+
+
+// Hora UTC de um registro pela última âncora do fluxo (0: desconhecida)
+static uint32_t record_unix(const log_record_t *rec) {
+    if (last_sync.type != LOG_REC_TIME_SYNC || last_sync.a == 0 || rec->t_ms < last_sync.t_ms) return 0;
+    return (uint32_t)last_sync.a + (rec->t_ms - last_sync.t_ms) / 1000u;
+}
+
+// Anexa um registro (no core1, chamado pelo serviço de log ou pelo dreno da
+// flash). O registro pode ter esperado na flash, até de um boot anterior: a
+// rotação usa a hora dele e cada arquivo novo começa com a última âncora que
+// passou pelo fluxo, nunca com uma montada agora.
+static FRESULT append_record(const log_record_t *rec, bool event) {
+    // Tenta reabrir a sessão caso o cartão não estivesse pronto na inicialização
+    if (!open_log_sd()) return FR_NOT_READY;
+
+    bool is_sync = rec->type == LOG_REC_TIME_SYNC;
+    if (is_sync) last_sync = *rec;
+
+    FRESULT fr = log_check_rotation(&sd_log, 2 * sizeof(*rec), record_unix(rec));
+    if (fr != FR_OK) return fr;
+
+    if (sd_log.file_changed && !is_sync && last_sync.type == LOG_REC_TIME_SYNC) {
+        fr = log_append(&sd_log, &last_sync, sizeof(last_sync), false);
+        if (fr != FR_OK) return fr;
+    }
+    sd_log.file_changed = false;
+    return log_append(&sd_log, rec, sizeof(*rec), event);
+}
+
+
+// Sink do serviço de log: o registro vai primeiro para a flash interna (rápida e
+// imune a falhas do cartão). Se a flash recusar, vai direto ao SD só quando ela
+// não tem nada pendente: senão passaria na frente de registros mais antigos e o
+// arquivo sairia da ordem de tempo que log_read_tail, o .IDX e log_query_time
+// supõem. Nesse caso é descartado (contado em errors do serviço de log).
+static FRESULT stage_record(const log_record_t *rec, bool event) {
+    if (flash_store_append(rec, event)) return FR_OK;
+    if (flash_store_pending()) return FR_DENIED;
+    return append_record(rec, event);
+}
+
+// Confirma no cartão um lote drenado da flash
+static FRESULT commit_sd(void) {
+    return log_flush(&sd_log);
+}
+
+// Apaga os arquivos com mais de LOG_RETENTION_DAYS dias (core1, no máximo uma
+// vez por LOG_PRUNE_INTERVAL_MS). Sem hora do GPS a idade dos arquivos é
+// desconhecida e nada é apagado.
+static void prune_old_logs(void) {
+    static bool pruned = false;
+    static uint32_t pruned_ms;
+
+    uint32_t now_ms = to_ms_since_boot(get_absolute_time());
+    if (pruned && now_ms - pruned_ms < LOG_PRUNE_INTERVAL_MS) return;
+    uint32_t now_s = time_service_unix();
+    if (now_s == 0) return;
+    pruned = true;
+    pruned_ms = now_ms;
+
+    utc_time_t cutoff;
+    time_service_civil(now_s - LOG_RETENTION_DAYS * 86400u, &cutoff);
+    FRESULT fr = log_prune_before(&sd_log, (uint32_t)(cutoff.year % 100) * 10000u + cutoff.month * 100u + cutoff.day);
+    if (fr != FR_OK) printf("\nFalha ao apagar logs antigos (erro: %d)\n", fr);
+}
+
+// Core1 com a fila vazia: drena a flash para o SD em lotes de setores inteiros
+// e, de hora em hora, apaga os logs fora do período de retenção
+static void drain_flash_to_sd(void) {
+    flash_store_poll(append_record, commit_sd);
+    prune_old_logs();
+}
+
+
+// Enfileira uma âncora de hora (core0) no primeiro registro do boot, quando o
+// relógio ganha hora e depois a cada TIME_SYNC_INTERVAL_MS. Ela segue o mesmo
+// caminho dos registros (flash, depois SD), então fica na ordem do fluxo. Sem
+// hora, a = 0 encerra a âncora do boot anterior (t_ms recomeçou do zero).
+static void push_time_sync(uint32_t t_ms) {
+    static bool sent = false, sent_valid;
+    static uint32_t sent_ms;
+
+    bool valid = time_service_valid();
+    if (sent && valid == sent_valid && (!valid || t_ms - sent_ms < TIME_SYNC_INTERVAL_MS)) return;
+
+    log_record_t sync;
+    log_record_make(&sync, LOG_REC_TIME_SYNC, t_ms, (int32_t)time_service_unix(), 0);
+    if (!log_service_push(&sync, false)) return; // anel cheio: tenta no próximo registro
+    sent = true;
+    sent_valid = valid;
+    sent_ms = t_ms;
 }
 
 
 // Inicialização do SPI 
 void init_spi_sdcard() {
-    spi_init(spi0, 1000 * 1000); // Inicializa SPI0 a 1MHz 
-    // Configura pinos MISO, SCK e MOSI como função SPI
-    gpio_set_function(SD_PIN_MISO, GPIO_FUNC_SPI);
-    gpio_set_function(SD_PIN_SCK, GPIO_FUNC_SPI);
-    gpio_set_function(SD_PIN_MOSI, GPIO_FUNC_SPI);
+    // SPI0 é compartilhado: o gerenciador só inicializa o periférico uma vez
+    // (o baud do SD, 1 MHz na inicialização e 12,5 MHz nos dados, é aplicado
+    // a cada seleção do cartão no diskio)
+    spi_bus_init(spi0, SD_PIN_SCK, SD_PIN_MOSI, SD_PIN_MISO);
 
     // Configura pino CS como saída digital
     gpio_init(SD_PIN_CS);
@@ -47,75 +211,102 @@ void init_spi_sdcard() {
     gpio_put(SD_PIN_CS, 1); // Deseleciona SDCard
 
     printf("SPI SDCard initialized\n");
+
+    // Monta o volume e abre o arquivo de log uma única vez
+    open_log_sd();
+
+    // Registros pendentes na flash (de antes de um reset) são drenados pelo core1
+    flash_store_init();
+
+    // A partir daqui as gravações no cartão e na flash de dados ficam no core1. O
+    // core0 só lê o cartão (read_*_from_sd), pelas funções travadas do logger
+    log_service_set_idle(drain_flash_to_sd);
+    log_service_start(stage_record, &sd_log);
 }
 
 
 // Escrita no SD Card
-void write_to_sd(double lat, double lon) {
-    FRESULT fr;
-
-    fr = f_mount(&fs, "", 1); // Monta o sistema de arquivos
-    if (fr != FR_OK) {
-        printf("\nFalha ao montar o SD Card (erro: %d)\n", fr);
-        return;
-    }
+void write_to_sd(int32_t lat_e7, int32_t lon_e7) {
+    // Registro binário: coordenadas em inteiros de 1e-7 grau (sem snprintf)
+    log_record_t rec;
+    log_record_make(&rec, LOG_REC_GPS_POS, to_ms_since_boot(get_absolute_time()), lat_e7, lon_e7);
+    push_time_sync(rec.t_ms);
 
-    /* Abre arquivo com flags:
-            FA_WRITE: Permite escrita
-            FA_OPEN_ALWAYS: Abre se existir, cria se não existir
-    */
-    fr = f_open(&fil, FILENAME, FA_WRITE | FA_OPEN_ALWAYS);
-    if (fr == FR_OK) {
-        f_lseek(&fil, f_size(&fil)); // Posiciona cursor no final do arquivo (modo append)
-
-        // Formata string com coordenadas (5 casas decimais)
-        char text[64];
-        snprintf(text, sizeof(text), "Lat: %.5f, Lon: %.5f\n", lat, lon);
-
-        // Bytes escritos 
-        UINT bw;
-        // Escreve dados no arquivo
-        fr = f_write(&fil, text, strlen(text), &bw);
-
-        // Verifica se escrita foi bem-sucedida
-        if (fr == FR_OK && bw == strlen(text)) {
-            printf("\nDados escritos (%u bytes)\n", bw);
-        } else {
-            printf("\nErro ao escrever (erro: %d)\n", fr);
-        }
-        // Fecha o arquivo
-        f_close(&fil);
+    // Enfileira para o core1 e retorna na hora; o cartão é acessado conforme a política
+    if (log_service_push(&rec, false)) {
+        printf("\nRegistro enfileirado para o SD (%u bytes)\n", (unsigned)sizeof(rec));
     } else {
-        printf("\nErro ao abrir arquivo (erro: %d)\n", fr);
+        printf("\nFila do SD cheia: registro descartado\n");
     }
 }
 
 
 // Leitura do SD Card
 void read_from_sd() { // Abre arquivo em modo leitura (FA_READ)
+    FIL fil;   // Arquivo aberto só por esta leitura
     FRESULT fr;
-    char buffer[128]; // Buffer de 128 bytes para leitura
+    log_record_t records[LOG_CODEC_FRAME_SIZE / sizeof(log_record_t)]; // Um setor por vez
     UINT br;
 
-    fr = f_open(&fil, FILENAME, FA_READ);
+    char name[LOG_NAME_SIZE];
+
+    // Nome do arquivo atual, com os registros em RAM já no cartão. Se o core1
+    // rodar o arquivo depois disto, a leitura mostra o anterior, já fechado.
+    if (log_current_file(&sd_log, name, true) == FR_NOT_ENABLED) return; // a sessão é (re)aberta pelo core1
+
+    fr = f_open(&fil, name, FA_READ);
     if (fr != FR_OK) {
         printf("\nFalha ao abrir arquivo para leitura (erro: %d)\n", fr);
         return;
     }
 
-    printf("\nConteúdo de de %s:\n", FILENAME);
-    //  Lê em chunks de 127 bytes (deixa 1 byte para '\0')
+    printf("\nConteúdo de de %s:\n", name);
     do {
         // Lê dados do arquivo
-        fr = f_read(&fil, buffer, sizeof(buffer) - 1, &br);
+        fr = f_read(&fil, records, sizeof(records), &br);
         if (fr != FR_OK) {
             printf("\nErro ao ler arquivo (erro: %d)\n", fr);
             break;
         }
-        buffer[br] = '\0'; // Adiciona terminador nulo para imprimir como string
-        printf("%s", buffer);
-    } while (br == sizeof(buffer) - 1); // enquanto ler quantidade máxima de bytes
+        // Setor com quadro comprimido ou com registros crus
+        if (br == sizeof(records) && log_codec_decode((const uint8_t *)records, print_record_cb, NULL) >= 0) continue;
+        for (UINT i = 0; i < br / sizeof(log_record_t); i++) {
+            print_record(&records[i]);
+        }
+    } while (br == sizeof(records)); // enquanto ler quantidade máxima de bytes
 
     // Fecha o arquivo após leitura
     f_close(&fil);
 }
+
+
+// Leitura dos últimos n registros gravados (custo constante de I/O)
+void read_tail_from_sd(unsigned int n) {
+    log_record_t records[8]; // Até 8 registros mais recentes
+    UINT br;
+    char name[LOG_NAME_SIZE];
+
+    if (log_current_file(&sd_log, name, false) != FR_OK) return; // a sessão é (re)aberta pelo core1
+
+    FRESULT fr = log_read_tail(&sd_log, n, records, sizeof(records), &br);
+    if (fr != FR_OK) {
+        printf("\nErro ao ler últimos registros (erro: %d)\n", fr);
+        return;
+    }
+    printf("\nÚltimo(s) registro(s) de %s:\n", name);
+    for (UINT i = 0; i < br / sizeof(log_record_t); i++) {
+        print_record(&records[i]);
+    }
+}
+
+
+// Registros com hora UTC (segundos Unix) em [from_s, to_s] no arquivo atual,
+// ex.: a última hora. Busca binária no índice .IDX + varredura limitada.
+void read_range_from_sd(uint32_t from_s, uint32_t to_s) {
+    char name[LOG_NAME_SIZE];
+    if (log_current_file(&sd_log, name, false) != FR_OK) return; // a sessão é (re)aberta pelo core1
+
+    printf("\nRegistros de %s entre %lu e %lu (UTC):\n", name, (unsigned long)from_s, (unsigned long)to_s);
+    FRESULT fr = log_query_time(&sd_log, from_s, to_s, print_query_cb, NULL);
+    if (fr != FR_OK) printf("\nErro na consulta por hora (erro: %d)\n", fr);
+}
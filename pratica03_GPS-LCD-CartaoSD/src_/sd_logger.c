@@ -0,0 +1,1114 @@
+#include "sd_logger.h"
+#include <stdio.h>       // snprintf (nomes de arquivo)
+#include <string.h>      // memcpy, strrchr
+#include "pico/stdlib.h" // to_ms_since_boot, get_absolute_time
+#include "pico/mutex.h"  // Sessões compartilhadas entre core0 e core1
+#include "sd_diskio.h"   // Fixação de setores de metadados no cache do diskio
+#include "diskio.h"      // disk_write/disk_ioctl para o modo contíguo
+#include "time_service.h" // Data para nomes de arquivos rotativos
+
+#if LOG_BUF_SIZE != FF_MAX_SS
+#error "O modo contíguo grava o buffer da sessão como um setor: LOG_BUF_SIZE deve ser igual a FF_MAX_SS"
+#endif
+#if LOG_BUF_SIZE != LOG_CODEC_FRAME_SIZE
+#error "A compressão usa o buffer da sessão como quadro: LOG_BUF_SIZE deve ser igual a LOG_CODEC_FRAME_SIZE"
+#endif
+_Static_assert(sizeof(log_sparse_entry_t) == 16, "log_sparse_entry_t deve ter 16 bytes (32 por setor)");
+
+
+static FATFS fs;             // Sistema de arquivos compartilhado por todas as sessões
+static int mount_count = 0;  // Número de sessões abertas que usam o volume montado
+
+// Serializa as funções públicas (logger em um core, leitores no outro).
+// Recursivo porque as funções públicas chamam umas às outras.
+auto_init_recursive_mutex(log_lock);
+
+#define LOG_LOCKED(call) do {                   \
+        recursive_mutex_enter_blocking(&log_lock); \
+        FRESULT fr_ = (call);                   \
+        recursive_mutex_exit(&log_lock);        \
+        return fr_;                             \
+    } while (0)
+
+
+static uint32_t now_ms(void) {
+    return to_ms_since_boot(get_absolute_time());
+}
+
+// Acessos diretos ao diskio (modo contíguo, cache) e ao estado interno do FatFs
+// usam o mesmo mutex (recursivo) com que o FatFs trava o volume, para não
+// intercalar com f_read/f_write de outro core
+static bool log_volume_lock(void) {
+#if FF_FS_REENTRANT
+    return ff_mutex_take(fs.ldrv) != 0;
+#else
+    return true;
+#endif
+}
+
+static void log_volume_unlock(void) {
+#if FF_FS_REENTRANT
+    ff_mutex_give(fs.ldrv);
+#endif
+}
+
+// Descarta a janela de setor do FIL (setores gravados por fora dele, no modo
+// contíguo). Campo interno do FatFs: só com o volume travado.
+static bool log_fil_invalidate(log_t *log) {
+    if (!log_volume_lock()) return false;
+    log->fil.sect = 0;
+    log_volume_unlock();
+    return true;
+}
+
+static DRESULT log_disk_write(const BYTE *buff, LBA_t sector) {
+    if (!log_volume_lock()) return RES_NOTRDY;
+    DRESULT res = disk_write(0, buff, sector, 1);
+    log_volume_unlock();
+    return res;
+}
+
+static DRESULT log_disk_ioctl(BYTE cmd, void *buff) {
+    if (!log_volume_lock()) return RES_NOTRDY;
+    DRESULT res = disk_ioctl(0, cmd, buff);
+    log_volume_unlock();
+    return res;
+}
+
+// Modo contíguo: grava o buffer como o setor correspondente ao fim do log,
+// sem passar pela FAT. Setor incompleto é completado com zeros e regravado
+// nas próximas drenagens; setor completo avança para o próximo.
+static FRESULT log_raw_drain(log_t *log) {
+    if (log->buf_len == 0) return FR_OK;
+
+    UINT used = log->buf_len;
+    memset(&log->buf[used], 0, LOG_BUF_SIZE - used);
+    if (log_disk_write(log->buf, log->raw_first_sector + log->raw_sector) != RES_OK) return FR_DISK_ERR;
+
+    if (used == LOG_BUF_SIZE) {
+        log->buf_len = 0;
+        log->raw_sector++;
+    }
+    return FR_OK;
+}
+
+// Constrói o mapa de clusters (uma única varredura da cadeia na FAT) e
+// posiciona o cursor no fim do arquivo usando o próprio mapa
+static FRESULT log_build_linkmap(log_t *log) {
+    log->clmt[0] = LOG_CLMT_SIZE;
+    log->fil.cltbl = log->clmt;
+    FRESULT fr = f_lseek(&log->fil, CREATE_LINKMAP);
+    log->clmt_valid = (fr == FR_OK);
+    log->clmt_used = log->clmt[0];
+
+    if (!log->clmt_valid) { // arquivo fragmentado demais: seek normal pela FAT
+        log->fil.cltbl = NULL;
+        return fr == FR_NOT_ENOUGH_CORE ? f_lseek(&log->fil, f_size(&log->fil)) : fr;
+    }
+
+    fr = f_lseek(&log->fil, f_size(&log->fil));
+    log->clmt_last_clust = f_size(&log->fil) ? log->fil.clust : 0;
+    log->fil.cltbl = NULL; // appends seguem a FAT (o fast seek não estende o arquivo)
+    return fr;
+}
+
+// Seek dentro do que já foi gravado: com o mapa, O(fragmentos) em vez de seguir
+// a FAT desde o primeiro cluster. O mapa só vale para o f_lseek; o f_write
+// seguinte roda sem ele, porque com cltbl o FatFs não estende a cadeia.
+static FRESULT log_seek(log_t *log, FSIZE_t ofs) {
+    if (log->clmt_valid) log->fil.cltbl = log->clmt;
+    FRESULT fr = f_lseek(&log->fil, ofs);
+    log->fil.cltbl = NULL;
+    return fr;
+}
+
+// Acrescenta ao mapa o cluster atual do FIL se o arquivo cresceu para um novo.
+// Um f_write de até LOG_BUF_SIZE bytes entra em no máximo um cluster novo.
+static void log_update_linkmap(log_t *log) {
+    DWORD clust = log->fil.clust;
+    if (!log->clmt_valid || clust == log->clmt_last_clust) return;
+
+    if (log->clmt_used >= 4 && clust == log->clmt[log->clmt_used - 2] + log->clmt[log->clmt_used - 3]) {
+        log->clmt[log->clmt_used - 3]++; // cluster seguinte ao último fragmento [tamanho, início]: só aumenta o tamanho
+    } else if (log->clmt_used + 2 <= LOG_CLMT_SIZE) {
+        log->clmt[log->clmt_used - 1] = 1;     // novo fragmento com um cluster
+        log->clmt[log->clmt_used] = clust;
+        log->clmt[log->clmt_used + 1] = 0;     // terminador
+        log->clmt_used += 2;
+    } else {
+        log->clmt_valid = false; // tabela cheia: volta ao seek pela FAT
+    }
+    log->clmt_last_clust = clust;
+}
+
+// Compressão: grava o quadro em montagem no seu lugar no arquivo (sempre o
+// setor inteiro, regravado a cada drenagem enquanto estiver aberto). close
+// passa ao quadro seguinte.
+static FRESULT log_frame_drain(log_t *log, bool close) {
+    if (log->frame_dirty) {
+        log_codec_finish(&log->codec);
+
+        FRESULT fr = FR_OK;
+        if (f_tell(&log->fil) != log->frame_start) fr = log_seek(log, log->frame_start);
+        UINT bw;
+        if (fr == FR_OK) fr = f_write(&log->fil, log->buf, LOG_BUF_SIZE, &bw);
+        if (fr != FR_OK) return fr;
+        if (bw != LOG_BUF_SIZE) return FR_DENIED; // volume cheio
+
+        log_update_linkmap(log);
+        log->frame_dirty = false;
+    }
+    if (close && log->codec.count) {
+        log->frame_start += LOG_BUF_SIZE;
+        log->end = log->frame_start;
+        log_codec_begin(&log->codec, log->buf);
+    }
+    return FR_OK;
+}
+
+// Compressão: começa no primeiro setor livre do arquivo, completando com zeros
+// o fim de um arquivo cru (o leitor reconhece quadros só em múltiplos de setor)
+static FRESULT log_frame_open(log_t *log) {
+    FSIZE_t size = f_size(&log->fil);
+    UINT pad = (UINT)(size % LOG_BUF_SIZE);
+    if (pad) {
+        UINT bw;
+        memset(log->buf, 0, LOG_BUF_SIZE);
+        FRESULT fr = f_write(&log->fil, log->buf, LOG_BUF_SIZE - pad, &bw);
+        if (fr != FR_OK) return fr;
+        if (bw != LOG_BUF_SIZE - pad) return FR_DENIED;
+    }
+    log->frame_start = f_size(&log->fil);
+    log->end = log->frame_start;
+    log->frame_dirty = false;
+    log_codec_begin(&log->codec, log->buf);
+    return FR_OK;
+}
+
+// Modo normal: o buffer sempre começa numa fronteira de setor do arquivo
+// (end - buf_len é múltiplo de LOG_BUF_SIZE). Setor completo vai num f_write
+// alinhado de 512 bytes, que o FatFs grava direto, sem ler antes nem copiar
+// pela janela do FIL. Setor incompleto (f_sync, leitura) é entregue e continua
+// no buffer, para ser regravado inteiro quando encher.
+static FRESULT log_file_drain(log_t *log) {
+    if (log->buf_len == log->buf_written) return FR_OK; // nada novo desde a última entrega
+
+    FSIZE_t start = log->end - log->buf_len;
+    FRESULT fr = FR_OK;
+    if (f_tell(&log->fil) != start) fr = log_seek(log, start);
+    UINT bw;
+    if (fr == FR_OK) fr = f_write(&log->fil, log->buf, log->buf_len, &bw);
+    if (fr != FR_OK) return fr;
+    if (bw != log->buf_len) return FR_DENIED; // volume cheio
+
+    log_update_linkmap(log);
+    log->buf_written = log->buf_len;
+    if (log->buf_len == LOG_BUF_SIZE) log->buf_len = log->buf_written = 0;
+    return FR_OK;
+}
+
+// Modo normal: traz para o buffer o setor incompleto do fim do arquivo, para
+// os próximos f_write começarem alinhados (uma leitura, só na abertura)
+static FRESULT log_file_open(log_t *log) {
+    UINT partial = (UINT)(log->end % LOG_BUF_SIZE);
+    if (partial == 0) return FR_OK;
+
+    FRESULT fr = log_seek(log, log->end - partial);
+    UINT br;
+    if (fr == FR_OK) fr = f_read(&log->fil, log->buf, partial, &br);
+    if (fr != FR_OK) return fr;
+    if (br != partial) return FR_INT_ERR;
+    log->buf_len = log->buf_written = partial;
+    return FR_OK;
+}
+
+// Entrega o conteúdo do buffer em RAM ao FatFs (sem f_sync)
+static FRESULT log_drain(log_t *log) {
+    if (log->raw) return log_raw_drain(log);
+    if (log->policy.compress) return log_frame_drain(log, false);
+    return log_file_drain(log);
+}
+
+// Verifica se algum critério da política pede f_sync
+static bool log_sync_due(const log_t *log, bool event) {
+    if (event && log->policy.sync_on_event) return true;
+    if (log->policy.sync_bytes && log->unsynced_bytes >= log->policy.sync_bytes) return true;
+    if (log->policy.sync_interval_ms && log->unsynced_bytes &&
+        now_ms() - log->last_sync_ms >= log->policy.sync_interval_ms) return true;
+    return false;
+}
+
+
+// Registra no anel o início de um novo registro
+static void log_index_push(log_t *log) {
+    log->index[log->index_head].offset = log->end;
+    log->index_head = (log->index_head + 1) % LOG_INDEX_SIZE;
+    if (log->index_count < LOG_INDEX_SIZE) log->index_count++;
+}
+
+// i-ésima entrada do anel, da mais antiga (0) para a mais recente
+static const log_index_entry_t *log_index_at(const log_t *log, UINT i) {
+    UINT oldest = (log->index_head + LOG_INDEX_SIZE - log->index_count) % LOG_INDEX_SIZE;
+    return &log->index[(oldest + i) % LOG_INDEX_SIZE];
+}
+
+// Lê [offset, offset + len) pelo próprio FIL da sessão e volta o cursor para o fim.
+// O buffer em RAM é entregue ao FatFs antes (sem f_sync), então a janela de
+// setor do FIL já contém os dados mais recentes (e o setor incompleto do fim,
+// que o próximo log_drain regrava sem ler).
+static FRESULT log_read_range(log_t *log, FSIZE_t offset, void *out, UINT len, UINT *br) {
+    FRESULT fr = log_drain(log);
+    if (fr != FR_OK) return fr;
+
+    // No modo contíguo os setores foram gravados por fora do FIL: descarta a
+    // janela de setor dele (nunca suja nesse modo) para forçar nova leitura
+    if (log->raw && !log_fil_invalidate(log)) return FR_TIMEOUT;
+
+    // Com o mapa de clusters, ida e volta custam O(1) em vez de seguir a FAT
+    if (log->clmt_valid) log->fil.cltbl = log->clmt;
+
+    fr = f_lseek(&log->fil, offset);
+    if (fr == FR_OK) fr = f_read(&log->fil, out, len, br);
+
+    FRESULT fr_seek = f_lseek(&log->fil, log->end);
+    log->fil.cltbl = NULL;
+    return fr != FR_OK ? fr : fr_seek;
+}
+
+
+// Informa ao cache do diskio onde estão a FAT e a entrada de diretório do
+// arquivo aberto, setores reescritos a cada f_sync e que devem permanecer em cache
+static void log_pin_metadata(const log_t *log) {
+    if (!log_volume_lock()) return;
+    disk_cache_clear_pins();
+#if FF_FS_EXFAT
+    if (fs.fs_type == FS_EXFAT) {
+        // Arquivos contíguos no exFAT não usam a FAT: o que muda ao crescer é o
+        // bitmap de alocação (1 bit por cluster)
+        disk_cache_pin_range(fs.bitbase, ((fs.n_fatent - 2) / 8 + FF_MAX_SS - 1) / FF_MAX_SS);
+    } else
+#endif
+    disk_cache_pin_range(fs.fatbase, (LBA_t)fs.fsize * fs.n_fats);
+    disk_cache_pin_range(log->fil.dir_sect, 1);
+    log_volume_unlock();
+}
+
+
+// Monta o volume na primeira sessão
+static FRESULT log_mount(void) {
+    if (mount_count == 0) {
+        FRESULT fr = f_mount(&fs, "", 1);
+        if (fr != FR_OK) return fr;
+    }
+    mount_count++;
+    return FR_OK;
+}
+
+// Desmonta o volume quando a última sessão é encerrada
+static void log_unmount(void) {
+    if (--mount_count == 0) f_unmount("");
+}
+
+// Estado que depende do arquivo aberto (zerado a cada abertura/rotação)
+static void log_reset_file_state(log_t *log, const char *filename) {
+    snprintf(log->name, sizeof(log->name), "%s", filename);
+    log->buf_len = 0;
+    log->buf_written = 0;
+    log->unsynced_bytes = 0;
+    log->last_sync_ms = now_ms();
+    log->end = f_size(&log->fil);
+    log->index_head = 0;
+    log->index_count = 0;
+    log->clmt_valid = false;
+    log->raw = false;
+    log->file_changed = true;
+    log->idx_open = false;
+    log->time_base.valid = false;
+}
+
+// ==========================
+// Índice esparso em arquivo (.IDX)
+// ==========================
+// Falhas no índice nunca interrompem o log: o índice é fechado e as consultas
+// passam a varrer o arquivo. Entradas que faltam no fim só alongam a varredura.
+
+// Nome do índice: o do log com a extensão trocada (.idx em nomes minúsculos)
+static void log_sparse_name(char *out, const char *name) {
+    snprintf(out, LOG_NAME_SIZE, "%s", name);
+    char *dot = strrchr(out, '.');
+    char *slash = strrchr(out, '/');
+    if (!dot || (slash && dot < slash)) dot = out + strlen(out);
+    bool lower = dot[0] && dot[1] >= 'a' && dot[1] <= 'z';
+    snprintf(dot, LOG_NAME_SIZE - (size_t)(dot - out), "%s", lower ? ".idx" : ".IDX");
+}
+
+static bool log_sparse_valid(const log_sparse_entry_t *e) {
+    log_sparse_entry_t tmp = *e;
+    tmp.crc = 0;
+    return e->magic == LOG_SPARSE_MAGIC && log_crc16(&tmp, sizeof(tmp)) == e->crc;
+}
+
+static FRESULT log_sparse_read(log_t *log, UINT i, log_sparse_entry_t *e) {
+    UINT br;
+    FRESULT fr = f_lseek(&log->idx_fil, (FSIZE_t)i * sizeof(*e));
+    if (fr == FR_OK) fr = f_read(&log->idx_fil, e, sizeof(*e), &br);
+    if (fr == FR_OK && (br != sizeof(*e) || !log_sparse_valid(e))) fr = FR_INT_ERR;
+    return fr;
+}
+
+static void log_sparse_disable(log_t *log) {
+    if (log->idx_open) f_close(&log->idx_fil);
+    log->idx_open = false;
+}
+
+// Abre o índice do log aberto e continua após a última entrada
+static void log_sparse_open(log_t *log) {
+    char name[LOG_NAME_SIZE];
+    log_sparse_name(name, log->name);
+    log->idx_pending_count = 0;
+    log->idx_since = LOG_SPARSE_EVERY; // o primeiro registro com hora ganha entrada
+    log->idx_last_unix = 0;
+    log->idx_dirty = false;
+    if (f_open(&log->idx_fil, name, FA_READ | FA_WRITE | FA_OPEN_ALWAYS) != FR_OK) return;
+    log->idx_open = true;
+
+    // Descarta entrada incompleta no fim (gravação interrompida) e índices de
+    // outro arquivo com o mesmo nome (entradas além do fim do log)
+    UINT count = (UINT)(f_size(&log->idx_fil) / sizeof(log_sparse_entry_t));
+    log_sparse_entry_t last;
+    if (count && (log_sparse_read(log, count - 1, &last) != FR_OK || last.offset >= log->end)) count = 0;
+    FRESULT fr = FR_OK;
+    if ((FSIZE_t)count * sizeof(last) != f_size(&log->idx_fil)) {
+        fr = f_lseek(&log->idx_fil, (FSIZE_t)count * sizeof(last));
+        if (fr == FR_OK) fr = f_truncate(&log->idx_fil);
+    }
+    if (fr != FR_OK) log_sparse_disable(log);
+    else if (count) log->idx_last_unix = last.unix_s;
+}
+
+// Grava as entradas pendentes no fim do índice (sem f_sync)
+static void log_sparse_drain(log_t *log) {
+    if (!log->idx_open || log->idx_pending_count == 0) return;
+
+    UINT len = log->idx_pending_count * sizeof(log_sparse_entry_t);
+    UINT bw;
+    FRESULT fr = f_lseek(&log->idx_fil, f_size(&log->idx_fil));
+    if (fr == FR_OK) fr = f_write(&log->idx_fil, log->idx_pending, len, &bw);
+    log->idx_pending_count = 0;
+    if (fr != FR_OK || bw != len) {
+        log_sparse_disable(log);
+        return;
+    }
+    log->idx_dirty = true;
+}
+
+// Chamado depois do f_sync do log: o índice nunca aponta para dados não confirmados
+static void log_sparse_sync(log_t *log) {
+    log_sparse_drain(log);
+    if (!log->idx_open || !log->idx_dirty) return;
+    if (f_sync(&log->idx_fil) != FR_OK) log_sparse_disable(log);
+    log->idx_dirty = false;
+}
+
+static void log_sparse_close(log_t *log) {
+    log_sparse_drain(log);
+    log_sparse_disable(log);
+}
+
+// Base de hora: registros LOG_REC_TIME_SYNC ligam t_ms à hora UTC. Com a = 0
+// (boot sem hora) a base anterior deixa de valer: t_ms recomeçou do zero.
+static void log_time_base_note(log_time_base_t *base, const log_record_t *rec) {
+    if (rec->type != LOG_REC_TIME_SYNC) return;
+    base->valid = rec->a != 0;
+    base->unix_s = (uint32_t)rec->a;
+    base->t_ms = rec->t_ms;
+}
+
+// Hora UTC de um registro (false: desconhecida, ex.: antes da primeira
+// sincronização ou após um reset sem nova sincronização)
+static bool log_time_base_unix(const log_time_base_t *base, const log_record_t *rec, uint32_t *unix_s) {
+    if (!base->valid || rec->t_ms < base->t_ms) return false;
+    *unix_s = base->unix_s + (rec->t_ms - base->t_ms) / 1000u;
+    return true;
+}
+
+// Acompanha a hora dos registros anexados e cria uma entrada a cada
+// LOG_SPARSE_EVERY registros. boundary: o registro pode ser ponto de partida de
+// uma varredura (com compressão, só o primeiro de um quadro).
+static void log_sparse_note(log_t *log, const log_record_t *rec, FSIZE_t offset, bool boundary) {
+    log_time_base_note(&log->time_base, rec);
+    log->idx_since++;
+
+    uint32_t unix_s;
+    if (!log->idx_open || !boundary || log->idx_since < LOG_SPARSE_EVERY || offset > UINT32_MAX) return;
+    if (!log_time_base_unix(&log->time_base, rec, &unix_s) || unix_s < log->idx_last_unix) return;
+
+    log_sparse_entry_t *e = &log->idx_pending[log->idx_pending_count++];
+    e->unix_s = unix_s;
+    e->t_ms = rec->t_ms;
+    e->offset = (uint32_t)offset;
+    e->magic = LOG_SPARSE_MAGIC;
+    e->crc = 0;
+    e->crc = log_crc16(e, sizeof(*e));
+    log->idx_last_unix = unix_s;
+    log->idx_since = 0;
+    if (log->idx_pending_count == LOG_SPARSE_PENDING) log_sparse_drain(log);
+}
+
+
+// Abre (ou cria) um arquivo em modo append dentro de uma sessão já montada
+static FRESULT log_open_file(log_t *log, const char *filename) {
+    FRESULT fr = f_open(&log->fil, filename, FA_READ | FA_WRITE | FA_OPEN_ALWAYS);
+    if (fr != FR_OK) return fr;
+
+    log_reset_file_state(log, filename);
+    fr = log_build_linkmap(log); // também posiciona no fim (modo append)
+    if (fr == FR_OK) fr = log->policy.compress ? log_frame_open(log) : log_file_open(log);
+    if (fr != FR_OK) {
+        f_close(&log->fil);
+        return fr;
+    }
+    log_pin_metadata(log);
+    log_sparse_open(log);
+    return FR_OK;
+}
+
+
+// Abre uma sessão: monta o volume (uma única vez) e abre o arquivo em modo append
+static FRESULT log_open_locked(log_t *log, const char *filename, const log_policy_t *policy) {
+    FRESULT fr = log_mount();
+    if (fr != FR_OK) return fr;
+
+    log->policy = *policy;
+    log->rotating = false;
+    fr = log_open_file(log, filename);
+    if (fr != FR_OK) {
+        log->is_open = false;
+        log_unmount();
+        return fr;
+    }
+    log->is_open = true;
+    return FR_OK;
+}
+
+
+// Data AAMMDD de um instante UTC
+static uint32_t log_date(const utc_time_t *utc) {
+    return (uint32_t)(utc->year % 100) * 10000u + utc->month * 100u + utc->day;
+}
+
+// Data atual no formato AAMMDD (0 enquanto o relógio não tem hora)
+static uint32_t log_today(void) {
+    utc_time_t utc;
+    if (!time_service_now(&utc)) return 0;
+    return log_date(&utc);
+}
+
+// Nome do arquivo rotativo de uma data AAMMDD e sequência (false: não cabe em
+// LOG_NAME_SIZE, só com data ou sequência fora da faixa)
+static bool log_make_name(char *out, const char *dir, uint32_t date, UINT seq) {
+#if FF_USE_LFN
+    unsigned long year = date ? 2000 + date / 10000 : 0;
+    int n = snprintf(out, LOG_NAME_SIZE, "%s/%04lu-%02lu-%02lu_%02u.bin", dir, year,
+                     (unsigned long)(date / 100 % 100), (unsigned long)(date % 100), seq);
+#else
+    int n = snprintf(out, LOG_NAME_SIZE, "%s/%06lu%02u.BIN", dir, (unsigned long)date, seq);
+#endif
+    return n > 0 && n < LOG_NAME_SIZE;
+}
+
+// Data AAMMDD no início do nome de um arquivo rotativo (false: outro arquivo)
+static bool log_name_date(const char *fname, uint32_t *date) {
+#if FF_USE_LFN
+    static const char pattern[] = "0000-00-00"; // AAAA-MM-DD
+    uint32_t year = 0, md = 0;
+    for (int i = 0; pattern[i]; i++) {
+        if (pattern[i] == '-') {
+            if (fname[i] != '-') return false;
+            continue;
+        }
+        if (fname[i] < '0' || fname[i] > '9') return false;
+        if (i < 4) year = year * 10 + (uint32_t)(fname[i] - '0');
+        else md = md * 10 + (uint32_t)(fname[i] - '0');
+    }
+    *date = year ? (year % 100) * 10000u + md : 0;
+#else
+    uint32_t d = 0;
+    for (int i = 0; i < 6; i++) {
+        if (fname[i] < '0' || fname[i] > '9') return false;
+        d = d * 10 + (uint32_t)(fname[i] - '0');
+    }
+    *date = d;
+#endif
+    return true;
+}
+
+// Escolhe o arquivo da data: continua o último existente se ainda houver
+// espaço, senão usa a próxima sequência livre
+static FRESULT log_open_dated(log_t *log, uint32_t date, UINT first_seq) {
+    char name[LOG_NAME_SIZE];
+    FILINFO fno;
+    UINT seq = first_seq;
+
+    if (date > 991231) return FR_INVALID_NAME;
+    for (; seq < 99; seq++) {
+        log_make_name(name, log->dir, date, seq + 1);
+        if (f_stat(name, &fno) != FR_OK) break; // próxima não existe: seq é a última
+    }
+    if (!log_make_name(name, log->dir, date, seq)) return FR_INVALID_NAME;
+    if (f_stat(name, &fno) == FR_OK && fno.fsize >= log->max_file_bytes && seq < 99) {
+        log_make_name(name, log->dir, date, ++seq);
+    }
+
+    FRESULT fr = log_open_file(log, name);
+    if (fr != FR_OK) return fr;
+    log->file_date = date;
+    log->file_seq = seq;
+    return FR_OK;
+}
+
+// Abre uma sessão com rotação automática: um arquivo por data
+// (DIR/AAMMDDnn.BIN, ou DIR/AAAA-MM-DD_nn.bin no perfil exFAT/LFN), trocado também quando atinge max_file_bytes.
+// Arquivos pequenos e nomeados pela data ficam rápidos de percorrer e
+// podem ser apagados por data sem ler o conteúdo (log_prune_before).
+static FRESULT log_open_rotating_locked(log_t *log, const char *dir, const log_policy_t *policy, FSIZE_t max_file_bytes) {
+    FRESULT fr = log_mount();
+    if (fr != FR_OK) return fr;
+
+    fr = f_mkdir(dir);
+    if (fr != FR_OK && fr != FR_EXIST) {
+        log_unmount();
+        return fr;
+    }
+
+    log->policy = *policy;
+    log->rotating = true;
+    snprintf(log->dir, sizeof(log->dir), "%s", dir);
+    log->max_file_bytes = max_file_bytes;
+    fr = log_open_dated(log, log_today(), 0);
+    if (fr != FR_OK) {
+        log->is_open = false;
+        log_unmount();
+        return fr;
+    }
+    log->is_open = true;
+    return FR_OK;
+}
+
+// Troca de arquivo se a data do registro mudou ou se len bytes não cabem no
+// atual. unix_s é a hora UTC do registro a anexar, não a de agora: um registro
+// que esperou na flash (ou veio de um boot anterior) vai para o arquivo da sua
+// data. 0 = hora desconhecida: fica no arquivo atual e só troca por tamanho.
+// log_append chama com 0; quem conhece a hora chama antes, o que também permite
+// gravar um cabeçalho (file_changed) no início do novo arquivo.
+static FRESULT log_check_rotation_locked(log_t *log, UINT len, uint32_t unix_s) {
+    if (!log->is_open) return FR_NOT_ENABLED;
+    if (!log->rotating) return FR_OK;
+
+    uint32_t date = log->file_date;
+    if (unix_s != 0) {
+        utc_time_t utc;
+        time_service_civil(unix_s, &utc);
+        date = log_date(&utc);
+    }
+    bool new_day = date != log->file_date;
+    if (!new_day && log->end + len <= log->max_file_bytes) return FR_OK;
+    if (!new_day && log->file_seq >= 99) return FR_OK; // sem sequência livre: cresce o último
+
+    FRESULT fr = log_drain(log);
+    FRESULT fr_close = f_close(&log->fil);
+    if (fr == FR_OK) fr = fr_close;
+    log_sparse_close(log);
+    if (fr == FR_OK) fr = log_open_dated(log, date, new_day ? 0 : log->file_seq + 1);
+    if (fr != FR_OK) log->is_open = false;
+    return fr;
+}
+
+// Apaga arquivos rotativos com data (do nome) anterior a date (AAMMDD).
+// Só lê o diretório; o arquivo aberto nunca é apagado, nem os de data 0
+// (gravados sem hora: a idade deles é desconhecida). As vítimas são juntadas
+// em lotes de LOG_PRUNE_BATCH com o diretório fechado e só então apagadas; a
+// varredura recomeça até um lote vir vazio.
+static FRESULT log_prune_before_locked(log_t *log, uint32_t date) {
+    if (!log->is_open || !log->rotating) return FR_NOT_ENABLED;
+
+    DIR dir;
+    FILINFO fno;
+    char victims[LOG_PRUNE_BATCH][LOG_NAME_SIZE], idx_name[LOG_NAME_SIZE];
+    log_sparse_name(idx_name, log->name);
+
+    for (;;) {
+        UINT n = 0;
+        FRESULT fr = f_opendir(&dir, log->dir);
+        if (fr != FR_OK) return fr;
+        while (n < LOG_PRUNE_BATCH && (fr = f_readdir(&dir, &fno)) == FR_OK && fno.fname[0]) {
+            uint32_t file_date;
+            if (!log_name_date(fno.fname, &file_date) || file_date == 0 || file_date >= date) continue;
+
+            // Nome longo demais para o caminho: não é um arquivo do logger
+            int len = snprintf(victims[n], LOG_NAME_SIZE, "%s/%s", log->dir, fno.fname);
+            if (len <= 0 || len >= LOG_NAME_SIZE) continue;
+            if (strcmp(victims[n], log->name) == 0 || strcmp(victims[n], idx_name) == 0) continue;
+            n++;
+        }
+        f_closedir(&dir);
+        if (fr != FR_OK) return fr;
+
+        for (UINT i = 0; i < n; i++) {
+            fr = f_unlink(victims[i]);
+            if (fr != FR_OK) return fr;
+        }
+        if (n < LOG_PRUNE_BATCH) return FR_OK; // a varredura chegou ao fim do diretório
+    }
+}
+
+
+// Cluster cujo primeiro setor está alinhado à AU (erase_block setores)
+static bool log_clust_aligned(DWORD clust, DWORD erase_block) {
+    return (fs.database + (LBA_t)(clust - 2) * fs.csize) % erase_block == 0;
+}
+
+// Reserva capacity bytes contíguos começando numa fronteira de AU. O f_expand
+// procura a partir da dica fs.last_clst: cada tentativa aponta a dica para o
+// próximo cluster alinhado e só aloca (opt = 1) se a área livre encontrada
+// começar exatamente nele. Os clusters alinhados se repetem a cada
+// erase_block / mdc(erase_block, csize). Melhor esforço: se a área de dados
+// não tiver cluster alinhado (formatação desalinhada) ou nenhuma área livre
+// alinhada aparecer em LOG_EXPAND_TRIES buscas, aloca onde o FatFs escolher.
+// Chamado com o volume travado (log_expand_aligned).
+static FRESULT log_expand_search(log_t *log, FSIZE_t capacity, DWORD erase_block) {
+    DWORD hint = fs.last_clst;
+    DWORD a = erase_block, b = fs.csize;
+    while (b) {
+        DWORD t = a % b;
+        a = b;
+        b = t;
+    }
+    DWORD period = erase_block / a;
+
+    DWORD first = 0;
+    for (DWORD c = 2; c < 2 + period && c < fs.n_fatent; c++) {
+        if (log_clust_aligned(c, erase_block)) {
+            first = c;
+            break;
+        }
+    }
+
+    DWORD c = first;
+    for (UINT tries = 0; first && c < fs.n_fatent && tries < LOG_EXPAND_TRIES; tries++) {
+        fs.last_clst = c;
+        FRESULT fr = f_expand(&log->fil, capacity, 0); // 0: só procura (dica = início - 1)
+        if (fr != FR_OK) break;
+        DWORD start = fs.last_clst + 1;
+        if (start == c) {
+            fs.last_clst = c;
+            fr = f_expand(&log->fil, capacity, 1);
+            log->raw_aligned = (fr == FR_OK);
+            return fr;
+        }
+        if (start < c) break; // a busca deu a volta no volume: nada alinhado depois de c
+        c = first + (start - first + period - 1) / period * period;
+    }
+
+    log->raw_aligned = false;
+    fs.last_clst = hint;
+    return f_expand(&log->fil, capacity, 1);
+}
+
+// fs.last_clst é estado interno do FatFs: a dica e os f_expand ficam sob um só
+// lock do volume, senão outro usuário (ex.: leitor no core0) a muda no meio
+static FRESULT log_expand_aligned(log_t *log, FSIZE_t capacity, DWORD erase_block) {
+    if (!log_volume_lock()) return FR_TIMEOUT;
+    FRESULT fr = log_expand_search(log, capacity, erase_block);
+    log_volume_unlock();
+    return fr;
+}
+
+// Abre uma sessão de alta taxa: cria o arquivo já com capacity bytes contíguos
+// (f_expand), arredondados para a unidade de apagamento (AU) do cartão e, se o
+// volume permitir, começando numa fronteira de AU (log->raw_aligned). Os
+// registros vão direto para setores consecutivos pelo diskio, sem percorrer
+// nem atualizar a FAT; o tamanho real é gravado no diretório em log_close.
+static FRESULT log_open_contiguous_locked(log_t *log, const char *filename, const log_policy_t *policy, FSIZE_t capacity) {
+    FRESULT fr = log_mount();
+    if (fr != FR_OK) return fr;
+
+    DWORD erase_block;
+    if (log_disk_ioctl(GET_BLOCK_SIZE, &erase_block) != RES_OK || erase_block == 0) erase_block = 1;
+    FSIZE_t align = (FSIZE_t)erase_block * LOG_BUF_SIZE;
+    capacity = (capacity + align - 1) / align * align;
+
+    fr = f_open(&log->fil, filename, FA_READ | FA_WRITE | FA_CREATE_ALWAYS);
+    if (fr != FR_OK) {
+        log_unmount();
+        return fr;
+    }
+
+    fr = log_expand_aligned(log, capacity, erase_block); // aloca agora (cadeia contígua)
+    if (fr == FR_OK) fr = f_sync(&log->fil); // persiste alocação e tamanho provisório
+    if (fr != FR_OK) {
+        f_close(&log->fil);
+        f_unlink(filename);
+        log_unmount();
+        return fr;
+    }
+
+    log->policy = *policy;
+    log->policy.compress = false; // o modo contíguo grava registros crus
+    log->rotating = false;
+    log->is_open = true;
+    log_reset_file_state(log, filename);
+    log_build_linkmap(log); // um único fragmento; cursor vai para o fim da área
+    log_pin_metadata(log);
+    log->end = 0;
+    log->raw = true;
+    log->raw_first_sector = fs.database + (LBA_t)(log->fil.obj.sclust - 2) * fs.csize;
+    log->raw_sector = 0;
+    log->raw_capacity = capacity;
+    return FR_OK;
+}
+
+// Anexa um registro ao buffer em RAM; só acessa o cartão quando o buffer
+// enche ou quando a política de sincronização pede
+static FRESULT log_append_locked(log_t *log, const void *data, UINT len, bool event) {
+    if (!log->is_open) return FR_NOT_ENABLED;
+    if (log->raw && log->end + len > log->raw_capacity) return FR_DENIED; // área pré-alocada cheia
+
+    if (log->policy.compress && len != sizeof(log_record_t)) return FR_INVALID_PARAMETER;
+
+    FRESULT fr_rot = log_check_rotation(log, len, 0);
+    if (fr_rot != FR_OK) return fr_rot;
+
+    if (log->policy.compress) {
+        log_record_t rec;
+        memcpy(&rec, data, sizeof(rec)); // data pode não estar alinhado
+        if (!log_codec_put(&log->codec, &rec)) {
+            FRESULT fr = log_frame_drain(log, true); // quadro cheio: grava e abre o próximo
+            if (fr != FR_OK) return fr;
+            log_codec_put(&log->codec, &rec); // sempre cabe num quadro vazio
+        }
+        log_sparse_note(log, &rec, log->frame_start, log->codec.count == 1);
+        log->frame_dirty = true;
+        log->end = log->frame_start + LOG_BUF_SIZE;
+        log->unsynced_bytes += len;
+        if (log_sync_due(log, event)) return log_flush(log);
+        return FR_OK;
+    }
+
+    log_index_push(log);
+    if (len == sizeof(log_record_t) && !log->raw) {
+        log_record_t rec;
+        memcpy(&rec, data, sizeof(rec));
+        log_sparse_note(log, &rec, log->end, true);
+    }
+
+    const uint8_t *src = (const uint8_t *)data;
+    while (len) {
+        UINT n = LOG_BUF_SIZE - log->buf_len;
+        if (n > len) n = len;
+        memcpy(&log->buf[log->buf_len], src, n);
+        log->buf_len += n;
+        log->end += n; // acompanha buf_len: o buffer começa em end - buf_len
+        log->unsynced_bytes += n;
+        src += n;
+        len -= n;
+
+        if (log->buf_len == LOG_BUF_SIZE) {
+            FRESULT fr = log_drain(log);
+            if (fr != FR_OK) return fr;
+        }
+    }
+
+    if (log_sync_due(log, event)) return log_flush(log);
+    return FR_OK;
+}
+
+// Aplica a política de tempo mesmo sem novos registros (chamar no loop principal)
+static FRESULT log_poll_locked(log_t *log) {
+    if (!log->is_open) return FR_NOT_ENABLED;
+    if (log_sync_due(log, false)) return log_flush(log);
+    return FR_OK;
+}
+
+// Grava o buffer e atualiza FAT/diretório no cartão (f_sync)
+static FRESULT log_flush_locked(log_t *log) {
+    if (!log->is_open) return FR_NOT_ENABLED;
+
+    FRESULT fr = log_drain(log);
+    if (fr != FR_OK) return fr;
+
+    if (log->raw) {
+        // Diretório já aponta para a área inteira; basta esvaziar o cache do diskio
+        if (log_disk_ioctl(CTRL_SYNC, NULL) != RES_OK) return FR_DISK_ERR;
+    } else {
+        fr = f_sync(&log->fil);
+        if (fr != FR_OK) return fr;
+        log_sparse_sync(log);
+    }
+
+    log->unsynced_bytes = 0;
+    log->last_sync_ms = now_ms();
+    return FR_OK;
+}
+
+// Copia o caminho do arquivo aberto; com flush, entrega antes o buffer e faz
+// f_sync, para o arquivo poder ser lido por outro FIL. O nome só muda na
+// rotação, sob o mesmo lock: a cópia nunca sai pela metade.
+static FRESULT log_current_file_locked(log_t *log, char name[LOG_NAME_SIZE], bool flush) {
+    if (!log->is_open) return FR_NOT_ENABLED;
+    FRESULT fr = flush ? log_flush_locked(log) : FR_OK;
+    memcpy(name, log->name, LOG_NAME_SIZE);
+    return fr;
+}
+
+// Encerra a sessão; desmonta o volume quando for a última
+static FRESULT log_close_locked(log_t *log) {
+    if (!log->is_open) return FR_NOT_ENABLED;
+
+    FRESULT fr = log_drain(log);
+    if (fr == FR_OK && log->raw) {
+        // Ajusta o tamanho do arquivo ao que foi realmente gravado e libera o resto
+        if (log_disk_ioctl(CTRL_SYNC, NULL) != RES_OK) fr = FR_DISK_ERR;
+        if (fr == FR_OK && !log_fil_invalidate(log)) fr = FR_TIMEOUT;
+        if (fr == FR_OK) fr = log_seek(log, log->end);
+        if (fr == FR_OK) fr = f_truncate(&log->fil);
+    }
+    FRESULT fr_close = f_close(&log->fil);
+    if (fr == FR_OK) fr = fr_close;
+    log_sparse_close(log);
+
+    log->is_open = false;
+    log_unmount();
+    return fr;
+}
+
+
+// Copia para out os registros de índice >= first de um quadro decodificado
+typedef struct {
+    log_record_t *out;
+    UINT first;
+    UINT index;
+} log_tail_ctx_t;
+
+static void log_tail_emit(const log_record_t *rec, void *ctx) {
+    log_tail_ctx_t *t = (log_tail_ctx_t *)ctx;
+    if (t->index++ >= t->first) memcpy(t->out++, rec, sizeof(*rec));
+}
+
+// Compressão: últimos n registros, do quadro em RAM para trás, um setor por quadro
+static FRESULT log_read_tail_frames(log_t *log, UINT n, log_record_t *out, UINT *br) {
+    static uint8_t frame[LOG_BUF_SIZE]; // protegido por log_lock
+    UINT need = n;
+    FSIZE_t start = log->frame_start;
+
+    log_codec_finish(&log->codec); // cabeçalho atualizado do quadro aberto
+    const uint8_t *f = log->buf;
+    for (;;) {
+        int count = log_codec_decode(f, NULL, NULL);
+        if (count < 0) return FR_INT_ERR;
+
+        UINT take = (UINT)count < need ? (UINT)count : need;
+        log_tail_ctx_t ctx = { out + (need - take), (UINT)count - take, 0 };
+        log_codec_decode(f, log_tail_emit, &ctx);
+        need -= take;
+        if (need == 0 || start == 0) break;
+
+        start -= LOG_BUF_SIZE;
+        UINT rd;
+        FRESULT fr = log_read_range(log, start, frame, LOG_BUF_SIZE, &rd);
+        if (fr != FR_OK) return fr;
+        if (rd != LOG_BUF_SIZE || frame[0] != LOG_CODEC_MAGIC) break; // início cru do arquivo
+        f = frame;
+    }
+
+    // Se o arquivo acabou antes, os registros lidos estão no fim de out
+    if (need) memmove(out, out + need, (n - need) * sizeof(*out));
+    *br = (n - need) * sizeof(*out);
+    return FR_OK;
+}
+
+// Lê os últimos n registros (limitado a LOG_INDEX_SIZE e ao tamanho de out).
+// Se não couberem todos, devolve apenas os mais recentes que cabem inteiros.
+// Com compressão o limite é só o tamanho de out.
+static FRESULT log_read_tail_locked(log_t *log, UINT n, void *out, UINT out_size, UINT *br) {
+    *br = 0;
+    if (!log->is_open) return FR_NOT_ENABLED;
+    if (log->policy.compress) {
+        if (n > out_size / sizeof(log_record_t)) n = out_size / sizeof(log_record_t);
+        return n ? log_read_tail_frames(log, n, (log_record_t *)out, br) : FR_OK;
+    }
+    if (n > log->index_count) n = log->index_count;
+    if (n == 0) return FR_OK;
+
+    UINT i = log->index_count - n;
+    while (i < log->index_count && log->end - log_index_at(log, i)->offset > out_size) i++;
+    if (i == log->index_count) return FR_OK; // nem o último registro cabe em out
+
+    FSIZE_t start = log_index_at(log, i)->offset;
+    return log_read_range(log, start, out, (UINT)(log->end - start), br);
+}
+
+// Lê a partir de um offset (ex.: o fim da leitura anterior) até encher out.
+// Quando o índice cobre a região, o resultado termina em fronteira de registro.
+static FRESULT log_read_from_locked(log_t *log, FSIZE_t offset, void *out, UINT out_size, UINT *br) {
+    *br = 0;
+    if (!log->is_open) return FR_NOT_ENABLED;
+    if (log->policy.compress) return FR_DENIED; // offsets de registros não existem no arquivo
+    if (offset >= log->end) return FR_OK;
+
+    FSIZE_t stop = log->end;
+    if (stop - offset > out_size) {
+        stop = offset + out_size;
+        // Recua até o início do último registro indexado que caberia inteiro
+        for (UINT i = log->index_count; i > 0; i--) {
+            FSIZE_t rec = log_index_at(log, i - 1)->offset;
+            if (rec <= stop) {
+                if (rec > offset) stop = rec;
+                break;
+            }
+        }
+    }
+    return log_read_range(log, offset, out, (UINT)(stop - offset), br);
+}
+
+// Varredura de log_query_time: registros em ordem, com a base de hora corrente
+typedef struct {
+    uint32_t from_s, to_s;
+    log_time_base_t base;
+    log_query_emit_t emit;
+    void *ctx;
+    bool done; // Passou de to_s
+} log_query_ctx_t;
+
+static void log_query_visit(const log_record_t *rec, void *ctx) {
+    log_query_ctx_t *q = (log_query_ctx_t *)ctx;
+    if (q->done) return;
+
+    log_time_base_note(&q->base, rec);
+    uint32_t unix_s;
+    if (!log_time_base_unix(&q->base, rec, &unix_s)) return;
+    if (unix_s > q->to_s) q->done = true;
+    else if (unix_s >= q->from_s) q->emit(rec, unix_s, q->ctx);
+}
+
+// Busca binária no índice: última entrada com unix_s <= from_s (ou a primeira).
+// log2(n) leituras de 16 bytes, quase sempre no mesmo punhado de setores.
+static FRESULT log_sparse_find(log_t *log, uint32_t from_s, log_sparse_entry_t *found, bool *ok) {
+    *ok = false;
+    UINT lo = 0, hi = (UINT)(f_size(&log->idx_fil) / sizeof(log_sparse_entry_t));
+    if (hi == 0) return FR_OK;
+
+    while (lo < hi) {
+        UINT mid = (lo + hi) / 2;
+        FRESULT fr = log_sparse_read(log, mid, found);
+        if (fr == FR_INT_ERR) return FR_OK; // entrada corrompida: varre o arquivo
+        if (fr != FR_OK) return fr;
+        if (found->unix_s <= from_s) lo = mid + 1;
+        else hi = mid;
+    }
+    FRESULT fr = log_sparse_read(log, lo ? lo - 1 : 0, found);
+    if (fr == FR_INT_ERR) return FR_OK;
+    *ok = (fr == FR_OK);
+    return fr;
+}
+
+// Entrega os registros com hora UTC em [from_s, to_s], em ordem. Parte da
+// entrada do índice anterior a from_s e para no primeiro registro depois de
+// to_s; sem índice, varre desde o início. Lê setores inteiros e reconhece
+// quadros comprimidos e registros crus no mesmo arquivo.
+static FRESULT log_query_time_locked(log_t *log, uint32_t from_s, uint32_t to_s, log_query_emit_t emit, void *ctx) {
+    static uint8_t chunk[LOG_BUF_SIZE]; // protegido por log_lock
+    if (!log->is_open) return FR_NOT_ENABLED;
+    if (from_s > to_s) return FR_INVALID_PARAMETER;
+
+    log_query_ctx_t q = { from_s, to_s, { false, 0, 0 }, emit, ctx, false };
+    FSIZE_t offset = 0;
+    if (log->idx_open) {
+        log_sparse_drain(log);
+        log_sparse_entry_t e;
+        bool found;
+        FRESULT fr = log_sparse_find(log, from_s, &e, &found);
+        if (fr != FR_OK) return fr;
+        if (found) {
+            offset = e.offset;
+            q.base.valid = true;
+            q.base.unix_s = e.unix_s;
+            q.base.t_ms = e.t_ms;
+        }
+    }
+
+    while (!q.done && offset < log->end) {
+        UINT br;
+        FRESULT fr = log_read_range(log, offset, chunk, LOG_BUF_SIZE - (UINT)(offset % LOG_BUF_SIZE), &br);
+        if (fr != FR_OK) return fr;
+        if (br == LOG_BUF_SIZE && log_codec_decode(chunk, log_query_visit, &q) >= 0) {
+            offset += br;
+            continue;
+        }
+        UINT used = br / sizeof(log_record_t) * sizeof(log_record_t);
+        if (used == 0) break; // resto menor que um registro no fim do log
+        for (UINT i = 0; i < used; i += sizeof(log_record_t)) {
+            log_record_t rec;
+            memcpy(&rec, &chunk[i], sizeof(rec));
+            if (log_record_valid(&rec)) log_query_visit(&rec, &q);
+        }
+        offset += used;
+    }
+    return FR_OK;
+}
+
+
+// ==========================
+// Interface pública (thread-safe)
+// ==========================
+FRESULT log_open(log_t *log, const char *filename, const log_policy_t *policy) {
+    LOG_LOCKED(log_open_locked(log, filename, policy));
+}
+
+FRESULT log_open_rotating(log_t *log, const char *dir, const log_policy_t *policy, FSIZE_t max_file_bytes) {
+    LOG_LOCKED(log_open_rotating_locked(log, dir, policy, max_file_bytes));
+}
+
+FRESULT log_check_rotation(log_t *log, UINT len, uint32_t unix_s) {
+    LOG_LOCKED(log_check_rotation_locked(log, len, unix_s));
+}
+
+FRESULT log_prune_before(log_t *log, uint32_t date) {
+    LOG_LOCKED(log_prune_before_locked(log, date));
+}
+
+FRESULT log_open_contiguous(log_t *log, const char *filename, const log_policy_t *policy, FSIZE_t capacity) {
+    LOG_LOCKED(log_open_contiguous_locked(log, filename, policy, capacity));
+}
+
+FRESULT log_append(log_t *log, const void *data, UINT len, bool event) {
+    LOG_LOCKED(log_append_locked(log, data, len, event));
+}
+
+FRESULT log_poll(log_t *log) {
+    LOG_LOCKED(log_poll_locked(log));
+}
+
+FRESULT log_flush(log_t *log) {
+    LOG_LOCKED(log_flush_locked(log));
+}
+
+FRESULT log_close(log_t *log) {
+    LOG_LOCKED(log_close_locked(log));
+}
+
+FRESULT log_current_file(log_t *log, char name[LOG_NAME_SIZE], bool flush) {
+    LOG_LOCKED(log_current_file_locked(log, name, flush));
+}
+
+FRESULT log_read_tail(log_t *log, UINT n, void *out, UINT out_size, UINT *br) {
+    LOG_LOCKED(log_read_tail_locked(log, n, out, out_size, br));
+}
+
+FRESULT log_read_from(log_t *log, FSIZE_t offset, void *out, UINT out_size, UINT *br) {
+    LOG_LOCKED(log_read_from_locked(log, offset, out, out_size, br));
+}
+
+FRESULT log_query_time(log_t *log, uint32_t from_s, uint32_t to_s, log_query_emit_t emit, void *ctx) {
+    LOG_LOCKED(log_query_time_locked(log, from_s, to_s, emit, ctx));
+}
@@ -0,0 +1,490 @@
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "hardware/spi.h"
+#include "hardware/dma.h"
+#include "ff.h"
+#include "diskio.h"
+#include "sd_diskio.h"
+#include "spi_bus.h"
+
+// Backend do diskio para cartão SD em modo SPI
+
+#define SD_SPI_PORT spi0
+#define SD_PIN_MISO 16
+#define SD_PIN_CS   28
+#define SD_PIN_SCK  18
+#define SD_PIN_MOSI 19
+
+#define SD_BLOCK_SIZE 512
+#define SD_SPI_BAUD_HZ (1000 * 1000) // 1 MHz na inicialização (a norma pede 100-400 kHz; os cartões aceitam 1 MHz)
+// Depois do ACMD41 o cartão aceita até 25 MHz; 12,5 MHz (clk_peri / 10) deixa
+// margem para a fiação da protoboard compartilhada com o display
+#ifndef SD_SPI_DATA_BAUD_HZ
+#define SD_SPI_DATA_BAUD_HZ (12500 * 1000)
+#endif
+
+// CRC16 dos blocos de dados (CMD59), calculado pelo sniffer do DMA durante a
+// transferência; em caso de divergência o bloco é relido/regravado
+#ifndef SD_SPI_CRC
+#define SD_SPI_CRC 1
+#endif
+#define SD_CRC_RETRIES 3
+
+// Timeouts (em microssegundos) medidos pelo timer do sistema
+#define SD_READY_TIMEOUT_US  500000 // cartão ocupado (programação de escrita pode levar até ~250 ms)
+#define SD_TOKEN_TIMEOUT_US  100000 // espera do token 0xFE em leituras
+
+static int is_sdhc = 0; // flag para indicar cartão SDHC/SDXC (endereçamento em LBA)
+static int is_sd2 = 0;  // flag para cartão SD v2+ (possui registrador SD Status)
+static bool busy_pending = false; // última escrita ainda pode estar sendo programada pelo cartão
+
+static spi_device_t sd_dev;     // SD Card no barramento compartilhado (spi0)
+static bool selected = false;   // barramento travado e CS baixo
+
+static int dma_tx = -1;         // canais de DMA dos blocos de dados (TX -> DR, DR -> RX)
+static int dma_rx = -1;
+static bool crc_on = false;     // CMD59 aceito: o cartão confere e envia CRC16 dos dados
+static uint32_t crc_errors = 0; // blocos com CRC divergente (lidos ou rejeitados pelo cartão)
+
+static uint8_t spi_transfer(uint8_t data) {
+    uint8_t rx;
+    spi_write_read_blocking(SD_SPI_PORT, &data, &rx, 1);
+    return rx;
+}
+
+// Transfere len bytes pelo DMA. tx == NULL envia 0xFF; rx == NULL descarta o recebido.
+// O sniffer acompanha o canal que carrega os dados do bloco (TX na escrita, RX na
+// leitura) e devolve o CRC-16-CCITT (semente 0, o mesmo do SD) sem custo de CPU.
+static uint16_t sd_dma_transfer(const uint8_t *tx, uint8_t *rx, UINT len) {
+    static const uint8_t ones = 0xFF;
+    static uint8_t sink;
+    volatile void *dr = &spi_get_hw(SD_SPI_PORT)->dr;
+
+    dma_channel_config c = dma_channel_get_default_config(dma_tx);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+    channel_config_set_dreq(&c, spi_get_dreq(SD_SPI_PORT, true));
+    channel_config_set_read_increment(&c, tx != NULL);
+    channel_config_set_write_increment(&c, false);
+    dma_channel_configure(dma_tx, &c, dr, tx ? tx : &ones, len, false);
+
+    c = dma_channel_get_default_config(dma_rx);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+    channel_config_set_dreq(&c, spi_get_dreq(SD_SPI_PORT, false));
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, rx != NULL);
+    dma_channel_configure(dma_rx, &c, rx ? rx : &sink, dr, len, false);
+
+    dma_sniffer_enable(tx ? dma_tx : dma_rx, DMA_SNIFF_CTRL_CALC_VALUE_CRC16, true);
+    dma_hw->sniff_data = 0;
+
+    dma_start_channel_mask((1u << dma_tx) | (1u << dma_rx));
+    dma_channel_wait_for_finish_blocking(dma_rx);
+    dma_sniffer_disable();
+    return (uint16_t)dma_hw->sniff_data;
+}
+
+// CRC7 do quadro de comando (obrigatório em todos os comandos após o CMD59)
+static uint8_t sd_crc7(const uint8_t *data, UINT len) {
+    uint8_t crc = 0;
+    for (UINT i = 0; i < len; i++) {
+        uint8_t d = data[i];
+        for (int b = 0; b < 8; b++) {
+            crc <<= 1;
+            if ((d ^ crc) & 0x80) crc ^= 0x09;
+            d <<= 1;
+        }
+    }
+    return crc & 0x7F;
+}
+
+// Seleciona o cartão: trava o barramento (aplica o baud do SD) e baixa o CS
+static void sd_select(void) {
+    if (selected) return;
+    spi_device_acquire(&sd_dev);
+    gpio_put(SD_PIN_CS, 0);
+    selected = true;
+}
+
+// Sobe o CS e envia um byte extra para o cartão liberar o MISO antes de soltar o barramento.
+// Toda operação do backend termina aqui, para o display nunca transmitir com o SD selecionado.
+static void sd_deselect(void) {
+    if (!selected) return;
+    gpio_put(SD_PIN_CS, 1);
+    spi_transfer(0xFF);
+    spi_device_release(&sd_dev);
+    selected = false;
+}
+
+// Espera o cartão liberar a linha MISO (0xFF), com prazo definido pelo timer.
+// O polling é feito byte a byte, sem sleep, para não acrescentar tempo morto.
+// Com uma escrita pendente o tempo de espera é registrado como DISK_LAT_BUSY.
+static uint8_t sd_wait_ready(uint32_t timeout_us) {
+    uint64_t start = time_us_64();
+    uint64_t deadline = start + timeout_us;
+    do {
+        if (spi_transfer(0xFF) == 0xFF) {
+            if (busy_pending) disk_lat_record(DISK_LAT_BUSY, (uint32_t)(time_us_64() - start));
+            busy_pending = false;
+            return 1;
+        }
+    } while (time_us_64() < deadline);
+    if (busy_pending) disk_lat_record(DISK_LAT_BUSY, timeout_us);
+    return 0;
+}
+
+// 80 clocks com CS alto para o cartão entrar em modo SPI
+static void sd_send_clock_train(void) {
+    spi_device_acquire(&sd_dev);
+    gpio_put(SD_PIN_CS, 1);
+    for (int i = 0; i < 10; i++) {
+        spi_transfer(0xFF);
+    }
+    spi_device_release(&sd_dev);
+}
+
+static uint8_t sd_command(uint8_t cmd, uint32_t arg) {
+    uint8_t frame[6] = { 0x40 | cmd, (uint8_t)(arg >> 24), (uint8_t)(arg >> 16),
+                         (uint8_t)(arg >> 8), (uint8_t)arg, 0 };
+    uint8_t res;
+
+    frame[5] = (uint8_t)(sd_crc7(frame, 5) << 1) | 0x01;
+
+    sd_deselect();
+    sd_select();
+
+    // Antes de cada comando verifica (de forma preguiçosa) se a escrita anterior terminou
+    if (!sd_wait_ready(SD_READY_TIMEOUT_US)) {
+        sd_deselect();
+        return 0xFF;
+    }
+
+    uint64_t t0 = time_us_64();
+    spi_write_blocking(SD_SPI_PORT, frame, sizeof(frame));
+
+    res = 0xFF;
+    for (int i = 0; i < 10; i++) {
+        res = spi_transfer(0xFF);
+        if (!(res & 0x80)) break;
+    }
+    disk_lat_record(DISK_LAT_CMD, (uint32_t)(time_us_64() - t0));
+    return res;
+}
+
+static uint8_t sd_acmd(uint8_t cmd, uint32_t arg) {
+    uint8_t res = sd_command(55, 0);
+    if (res > 1) return res;
+    return sd_command(cmd, arg);
+}
+
+
+// Inicializa o cartão (CMD0, CMD8, ACMD41, CMD58)
+static DSTATUS sd_card_init(void) {
+    sd_send_clock_train();
+
+    uint8_t res;
+
+    res = sd_command(0, 0); // CMD0
+    printf("CMD0 response: 0x%02X\n", res);
+    if (res != 1) return STA_NOINIT;
+
+    res = sd_command(8, 0x1AA); // CMD8
+    printf("CMD8 response: 0x%02X\n", res);
+
+    if (res == 1) {
+        // SD v2+
+        is_sd2 = 1;
+        for (int i = 0; i < 4; i++) spi_transfer(0xFF); // lê 4 bytes da resposta do CMD8
+
+        int timeout = 1000;
+        do {
+            res = sd_acmd(41, 0x40000000);
+            printf("ACMD41 response: 0x%02X\n", res);
+            sd_deselect(); // libera o barramento enquanto o cartão inicializa
+            sleep_ms(1);
+            if (--timeout == 0) break;
+        } while (res != 0);
+
+        if (res != 0) return STA_NOINIT;
+
+        res = sd_command(58, 0);
+        printf("CMD58 response: 0x%02X\n", res);
+        if (res != 0) return STA_NOINIT;
+
+        uint8_t ocr[4];
+        for (int i = 0; i < 4; i++) ocr[i] = spi_transfer(0xFF);
+        // Verifica se é SDHC (bit 6 do primeiro byte da OCR)
+        if (ocr[0] & 0x40) {
+            is_sdhc = 1;
+            printf("Cartão SDHC/SDXC detectado\n");
+        } else {
+            is_sdhc = 0;
+            printf("Cartão SDSC detectado\n");
+        }
+    } else {
+        // SD v1 ou MMC fallback
+        int timeout = 1000;
+        do {
+            res = sd_acmd(41, 0);
+            printf("ACMD41 fallback response: 0x%02X\n", res);
+            sd_deselect();
+            sleep_ms(1);
+            if (--timeout == 0) break;
+        } while (res != 0);
+
+        if (res != 0) return STA_NOINIT;
+
+        is_sdhc = 0;
+    }
+
+#if SD_SPI_CRC
+    res = sd_command(59, 1); // CRC_ON_OFF
+    crc_on = (res == 0);
+    printf("CMD59 response: 0x%02X (CRC %s)\n", res, crc_on ? "ligado" : "desligado");
+#endif
+
+    return 0;
+}
+
+// Registra o cartão no barramento SPI compartilhado e o inicializa
+static DSTATUS sd_spi_initialize(void) {
+    spi_bus_init(SD_SPI_PORT, SD_PIN_SCK, SD_PIN_MOSI, SD_PIN_MISO);
+    spi_device_init(&sd_dev, SD_SPI_PORT, SD_PIN_CS, SD_SPI_BAUD_HZ, 8, SPI_CPOL_0, SPI_CPHA_0);
+    if (dma_tx < 0) {
+        dma_tx = dma_claim_unused_channel(true);
+        dma_rx = dma_claim_unused_channel(true);
+    }
+    crc_on = false;
+
+    DSTATUS st = sd_card_init();
+    sd_deselect();
+    if (st == 0) {
+        spi_device_set_baud(&sd_dev, SD_SPI_DATA_BAUD_HZ);
+        printf("SD SPI: %u Hz\n", sd_dev.baud_hz);
+    }
+    return st;
+}
+
+// Recebe um bloco de dados após um comando de leitura: token 0xFE, dados (DMA) e CRC
+static bool sd_receive_datablock(BYTE *buff, UINT len) {
+    // Aguarda token 0xFE com timeout
+    uint64_t t0 = time_us_64();
+    uint64_t deadline = t0 + SD_TOKEN_TIMEOUT_US;
+    uint8_t token;
+    do {
+        token = spi_transfer(0xFF);
+        if (token == 0xFE) break;
+    } while (time_us_64() < deadline);
+
+    uint64_t t1 = time_us_64();
+    disk_lat_record(DISK_LAT_TOKEN, (uint32_t)(t1 - t0));
+    if (token != 0xFE) return false;
+
+    uint16_t crc = sd_dma_transfer(NULL, buff, len);
+
+    uint16_t card_crc = (uint16_t)(spi_transfer(0xFF) << 8);
+    card_crc |= spi_transfer(0xFF);
+    disk_lat_record(DISK_LAT_XFER, (uint32_t)(time_us_64() - t1));
+    if (crc_on && crc != card_crc) {
+        crc_errors++;
+        return false;
+    }
+    return true;
+}
+
+// Encerra a leitura de vários blocos (CMD12) com o cartão ainda selecionado:
+// o cartão está enviando dados, então não há espera de pronto antes do comando
+static bool sd_stop_transmission(void) {
+    uint8_t frame[6] = { 0x40 | 12, 0, 0, 0, 0, 0 };
+    frame[5] = (uint8_t)(sd_crc7(frame, 5) << 1) | 0x01;
+
+    uint64_t t0 = time_us_64();
+    spi_write_blocking(SD_SPI_PORT, frame, sizeof(frame));
+    spi_transfer(0xFF); // byte de enchimento após o CMD12
+
+    uint8_t res = 0xFF;
+    for (int i = 0; i < 10; i++) {
+        res = spi_transfer(0xFF);
+        if (!(res & 0x80)) break;
+    }
+    disk_lat_record(DISK_LAT_CMD, (uint32_t)(time_us_64() - t0));
+    return res == 0 && sd_wait_ready(SD_READY_TIMEOUT_US); // R1b: ocupado até parar
+}
+
+// Leitura de um setor (CMD17, repetido se o bloco chegar corrompido)
+static DRESULT sd_read_single(BYTE *buff, LBA_t sector) {
+    uint32_t address = is_sdhc ? sector : sector * SD_BLOCK_SIZE;
+
+    for (int tries = 0; ; tries++) {
+        if (sd_command(17, address) != 0) return RES_ERROR;
+        if (sd_receive_datablock(buff, SD_BLOCK_SIZE)) return RES_OK;
+        if (tries == SD_CRC_RETRIES) return RES_ERROR;
+    }
+}
+
+// Leitura de vários setores com um único CMD18: o cartão envia os blocos em
+// sequência até o CMD12, sem um comando e uma espera de token por setor.
+// Um bloco corrompido encerra a rajada, que recomeça nele.
+static DRESULT sd_read_multi(BYTE *buff, LBA_t sector, UINT count) {
+    int tries = 0;
+
+    while (count) {
+        uint32_t address = is_sdhc ? sector : sector * SD_BLOCK_SIZE;
+        if (sd_command(18, address) != 0) return RES_ERROR;
+
+        UINT done = 0;
+        while (done < count && sd_receive_datablock(buff + done * SD_BLOCK_SIZE, SD_BLOCK_SIZE)) done++;
+        // Sem o CMD12 confirmado o cartão pode continuar enviando blocos: um novo
+        // CMD18 seria lido no meio da rajada, então a leitura falha aqui
+        if (!sd_stop_transmission()) return RES_ERROR;
+
+        buff += done * SD_BLOCK_SIZE;
+        sector += done;
+        count -= done;
+        if (done) tries = 0;
+        else if (tries++ == SD_CRC_RETRIES) return RES_ERROR;
+    }
+    return RES_OK;
+}
+
+// Leitura direta do cartão
+static DRESULT sd_read_blocks(BYTE *buff, LBA_t sector, UINT count) {
+    DRESULT res = count > 1 ? sd_read_multi(buff, sector, count) : sd_read_single(buff, sector);
+    sd_deselect();
+    return res;
+}
+
+// AU_SIZE do SD Status (4 bits) em setores: 16 KiB a 4 MiB dobram a cada código,
+// acima disso a norma lista 8, 12, 16, 24, 32 e 64 MiB. 0 = não definido.
+static const DWORD sd_au_sectors[16] = {
+    0, 32, 64, 128, 256, 512, 1024, 2048, 4096, 8192,
+    16384, 24576, 32768, 49152, 65536, 131072,
+};
+
+// Tamanho da unidade de alocação (AU) do cartão em setores, lido do SD Status (ACMD13).
+// 1 quando o cartão não informa (convenção do GET_BLOCK_SIZE do FatFs: desconhecido).
+static DRESULT sd_get_erase_block(DWORD *sectors) {
+    uint8_t sd_status[64];
+
+    if (!is_sd2) { // SD v1: sem SD Status, assume 1 setor
+        *sectors = 1;
+        return RES_OK;
+    }
+    bool ok = sd_acmd(13, 0) == 0;
+    if (ok) {
+        spi_transfer(0xFF); // segundo byte da resposta R2
+        ok = sd_receive_datablock(sd_status, sizeof(sd_status));
+    }
+    sd_deselect();
+    if (!ok) return RES_ERROR;
+
+    DWORD au = sd_au_sectors[sd_status[10] >> 4];
+    *sectors = au ? au : 1;
+    return RES_OK;
+}
+
+// Capacidade do cartão em setores, calculada a partir do CSD (CMD9).
+// CSD v2 (SDHC/SDXC): (C_SIZE + 1) * 512 KiB.
+// CSD v1 (SDSC): (C_SIZE + 1) * 2^(C_SIZE_MULT + 2) blocos de 2^READ_BL_LEN bytes.
+static DRESULT sd_get_sector_count(LBA_t *sectors) {
+    uint8_t csd[16];
+
+    bool ok = sd_command(9, 0) == 0 && sd_receive_datablock(csd, sizeof(csd));
+    sd_deselect();
+    if (!ok) return RES_ERROR;
+
+    if ((csd[0] >> 6) == 1) {
+        DWORD c_size = ((DWORD)(csd[7] & 0x3F) << 16) | ((DWORD)csd[8] << 8) | csd[9];
+        *sectors = (LBA_t)(c_size + 1) << 10;
+    } else {
+        DWORD c_size = ((DWORD)(csd[6] & 0x03) << 10) | ((DWORD)csd[7] << 2) | (csd[8] >> 6);
+        UINT c_size_mult = ((csd[9] & 0x03) << 1) | (csd[10] >> 7);
+        UINT read_bl_len = csd[5] & 0x0F;
+        *sectors = (LBA_t)(c_size + 1) << (c_size_mult + 2 + read_bl_len - 9);
+    }
+    return RES_OK;
+}
+
+// Envia um bloco após o CMD24: token 0xFE, dados (DMA), CRC do sniffer e resposta do cartão
+static uint8_t sd_send_datablock(const BYTE *buff) {
+    uint64_t t0 = time_us_64();
+    spi_transfer(0xFF);
+    spi_transfer(0xFE);
+
+    uint16_t crc = sd_dma_transfer(buff, NULL, SD_BLOCK_SIZE);
+    spi_transfer((uint8_t)(crc >> 8)); // sem CMD59 o cartão ignora estes bytes
+    spi_transfer((uint8_t)crc);
+
+    uint8_t resp = spi_transfer(0xFF) & 0x1F;
+    disk_lat_record(DISK_LAT_XFER, (uint32_t)(time_us_64() - t0));
+    return resp;
+}
+
+// Escrita direta no cartão (CMD24 por setor, repetido se o cartão acusar erro de CRC)
+static DRESULT sd_write_blocks(const BYTE *buff, LBA_t sector, UINT count) {
+    DRESULT res = RES_OK;
+
+    while (res == RES_OK && count--) {
+        uint32_t address = is_sdhc ? sector : sector * SD_BLOCK_SIZE;
+
+        for (int tries = 0; ; tries++) {
+            if (sd_command(24, address) != 0) {
+                res = RES_ERROR;
+                break;
+            }
+            uint8_t resp = sd_send_datablock(buff);
+
+            // Não espera o fim da programação aqui: o busy é verificado antes do
+            // próximo comando (sd_command) ou no CTRL_SYNC, liberando a aplicação
+            busy_pending = true;
+
+            if (resp == 0x05) break;                   // aceito
+            if (resp == 0x0B) crc_errors++;            // rejeitado por CRC
+            if (resp != 0x0B || tries == SD_CRC_RETRIES) {
+                res = RES_ERROR;
+                break;
+            }
+        }
+        buff += SD_BLOCK_SIZE;
+        sector++;
+    }
+
+    sd_deselect();
+    return res;
+}
+
+// Garante que a última escrita foi concluída pelo cartão
+static DRESULT sd_spi_sync(void) {
+    if (busy_pending) {
+        sd_select();
+        uint8_t ready = sd_wait_ready(SD_READY_TIMEOUT_US);
+        sd_deselect();
+        if (!ready) return RES_ERROR;
+    }
+    return RES_OK;
+}
+
+static DRESULT sd_spi_ioctl(BYTE cmd, void *buff) {
+    switch (cmd) {
+    case GET_SECTOR_SIZE:
+        *(WORD *)buff = SD_BLOCK_SIZE;
+        return RES_OK;
+    case GET_BLOCK_SIZE: // unidade de apagamento (AU) em setores
+        return sd_get_erase_block((DWORD *)buff);
+    case GET_SECTOR_COUNT:
+        return sd_get_sector_count((LBA_t *)buff);
+    }
+    return RES_PARERR;
+}
+
+// Blocos com CRC divergente desde o boot (cada um gerou uma nova tentativa)
+uint32_t sd_spi_crc_errors(void) {
+    return crc_errors;
+}
+
+const disk_backend_t sd_spi_backend = {
+    .initialize = sd_spi_initialize,
+    .read = sd_read_blocks,
+    .write = sd_write_blocks,
+    .sync = sd_spi_sync,
+    .ioctl = sd_spi_ioctl,
+};
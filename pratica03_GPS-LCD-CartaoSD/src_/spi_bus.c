@@ -0,0 +1,100 @@
+#include "spi_bus.h"
+#include "pico/mutex.h"
+
+// Estado de cada instância SPI (spi0, spi1)
+typedef struct {
+    const spi_device_t *active; // Dispositivo cujo baud/formato está carregado no periférico
+    bool initialized;
+} spi_bus_t;
+
+auto_init_mutex(spi0_lock);
+auto_init_mutex(spi1_lock);
+
+static mutex_t *const bus_lock[2] = { &spi0_lock, &spi1_lock };
+static spi_bus_t buses[2];
+
+
+// Inicializa o periférico na primeira chamada; as seguintes só configuram os pinos
+void spi_bus_init(spi_inst_t *spi, uint sck_pin, uint mosi_pin, uint miso_pin) {
+    uint idx = spi_get_index(spi);
+    mutex_enter_blocking(bus_lock[idx]);
+
+    if (!buses[idx].initialized) {
+        spi_init(spi, 1000 * 1000); // Baud provisório: cada dispositivo aplica o seu
+        buses[idx].active = NULL;
+        buses[idx].initialized = true;
+    }
+    if (sck_pin != SPI_BUS_NO_PIN) gpio_set_function(sck_pin, GPIO_FUNC_SPI);
+    if (mosi_pin != SPI_BUS_NO_PIN) gpio_set_function(mosi_pin, GPIO_FUNC_SPI);
+    if (miso_pin != SPI_BUS_NO_PIN) gpio_set_function(miso_pin, GPIO_FUNC_SPI);
+
+    mutex_exit(bus_lock[idx]);
+}
+
+
+// Registra um dispositivo: CS como saída em nível alto e registradores calculados
+// pelo SDK, guardados para a troca rápida em spi_device_acquire
+void spi_device_init(spi_device_t *dev, spi_inst_t *spi, uint cs_pin, uint baud_hz,
+                     uint data_bits, spi_cpol_t cpol, spi_cpha_t cpha) {
+    uint idx = spi_get_index(spi);
+
+    dev->spi = spi;
+    dev->cs_pin = cs_pin;
+    gpio_init(cs_pin);
+    gpio_set_dir(cs_pin, GPIO_OUT);
+    gpio_put(cs_pin, 1);
+
+    mutex_enter_blocking(bus_lock[idx]);
+    dev->baud_hz = spi_set_baudrate(spi, baud_hz);
+    spi_set_format(spi, data_bits, cpol, cpha, SPI_MSB_FIRST);
+    dev->cr0 = spi_get_hw(spi)->cr0;
+    dev->cpsr = spi_get_hw(spi)->cpsr;
+    buses[idx].active = dev;
+    mutex_exit(bus_lock[idx]);
+}
+
+
+// Troca o baud de um dispositivo já registrado (ex.: SD após a inicialização).
+// O cálculo é feito no periférico com o formato do próprio dispositivo carregado.
+void spi_device_set_baud(spi_device_t *dev, uint baud_hz) {
+    spi_device_acquire(dev);
+    dev->baud_hz = spi_set_baudrate(dev->spi, baud_hz);
+    dev->cr0 = spi_get_hw(dev->spi)->cr0;
+    dev->cpsr = spi_get_hw(dev->spi)->cpsr;
+    spi_device_release(dev);
+}
+
+
+void spi_device_acquire(spi_device_t *dev) {
+    uint idx = spi_get_index(dev->spi);
+    mutex_enter_blocking(bus_lock[idx]);
+
+    if (buses[idx].active != dev) {
+        // As funções bloqueantes do SDK só retornam com o periférico ocioso,
+        // então basta desabilitar o SSP, trocar os dois registradores e reabilitar
+        spi_hw_t *hw = spi_get_hw(dev->spi);
+        uint32_t enabled = hw->cr1 & SPI_SSPCR1_SSE_BITS;
+        hw_clear_bits(&hw->cr1, SPI_SSPCR1_SSE_BITS);
+        hw->cpsr = dev->cpsr;
+        hw->cr0 = dev->cr0;
+        hw_set_bits(&hw->cr1, enabled);
+        buses[idx].active = dev;
+    }
+}
+
+
+void spi_device_release(spi_device_t *dev) {
+    mutex_exit(bus_lock[spi_get_index(dev->spi)]);
+}
+
+
+void spi_device_select(spi_device_t *dev) {
+    spi_device_acquire(dev);
+    gpio_put(dev->cs_pin, 0);
+}
+
+
+void spi_device_deselect(spi_device_t *dev) {
+    gpio_put(dev->cs_pin, 1);
+    spi_device_release(dev);
+}
@@ -5,6 +5,7 @@
 #include <string.h> // usadas no texto
 #include "pico/stdlib.h" // Para os GPIOs
 #include "hardware/spi.h" // API de SPI do RP2040
+#include "spi_bus.h" // Barramento SPI0 compartilhado com o SD Card
 
 
 // ==========================
@@ -17,6 +18,10 @@
 #define PIN_RST  20 // GPIO 20 -> Reset do display (ativo em nível baixo)
 #define PIN_BL    9 // GPIO 9  -> Backlight (luz de fundo)
 
+#define ST7789_SPI_BAUD_HZ (40 * 1000 * 1000) // 40 MHz, aplicado a cada seleção do display
+
+static spi_device_t lcd_dev; // Display no barramento compartilhado (CS, baud e formato próprios)
+
 
 // ==========================
 // ST7789 - comandos e geometry
@@ -38,8 +43,8 @@
 // ==========================
 // GPIO helpers - Controlam seleção do display e modo comando/dado
 // ==========================
-static inline void st7789_select(void)   { gpio_put(PIN_CS, 0); }  // Baixa CS: seleciona o display
-static inline void st7789_deselect(void) { gpio_put(PIN_CS, 1); }  // Sobe CS: deseleciona o display
+static inline void st7789_select(void)   { spi_device_select(&lcd_dev); }    // Trava o SPI0 (40 MHz) e baixa CS
+static inline void st7789_deselect(void) { spi_device_deselect(&lcd_dev); }  // Sobe CS e libera o SPI0
 static inline void st7789_dc_cmd(void)   { gpio_put(PIN_DC, 0); }  // DC=0: a próxima transferência é comando
 static inline void st7789_dc_data(void)  { gpio_put(PIN_DC, 1); }  // DC=1: a próxima transferência é dados
 
@@ -92,15 +97,12 @@ static void st7789_set_addr_window(uint16_t x0, uint16_t y0, uint16_t x1, uint16
 // Inicializa o display e prepara para uso
 // ==========================
 void st7789_init(void) {
-    gpio_init(PIN_CS);  gpio_set_dir(PIN_CS,  GPIO_OUT); gpio_put(PIN_CS, 1); // CS como saída, inicia alto (inativo)
     gpio_init(PIN_DC);  gpio_set_dir(PIN_DC,  GPIO_OUT);  // DC como saída
     gpio_init(PIN_RST); gpio_set_dir(PIN_RST, GPIO_OUT);  // RST como saída
     gpio_init(PIN_BL);  gpio_set_dir(PIN_BL,  GPIO_OUT);   // BL como saída
 
-    spi_init(spi0, 40 * 1000 * 1000);  // Inicializa SPI0 a 40 MHz
-    spi_set_format(spi0, 8, SPI_CPOL_0, SPI_CPHA_0, SPI_MSB_FIRST); // 8 bits, modo 0, MSB primeiro
-    gpio_set_function(PIN_MOSI, GPIO_FUNC_SPI);  // Configura GPIO MOSI para função SPI
-    gpio_set_function(PIN_SCK,  GPIO_FUNC_SPI);  // Configura GPIO SCK  para função SPI
+    spi_bus_init(spi0, PIN_SCK, PIN_MOSI, SPI_BUS_NO_PIN);  // SPI0 compartilhado (só inicializa uma vez); display não usa MISO
+    spi_device_init(&lcd_dev, spi0, PIN_CS, ST7789_SPI_BAUD_HZ, 8, SPI_CPOL_0, SPI_CPHA_0); // CS alto, 8 bits, modo 0
 
     gpio_put(PIN_RST, 0); sleep_ms(50);  // Reset físico do display (baixa RST por 50 ms)
     gpio_put(PIN_RST, 1); sleep_ms(50); // Libera reset e aguarda estabilizar
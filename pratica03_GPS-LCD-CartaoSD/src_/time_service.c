@@ -0,0 +1,123 @@
+#include "time_service.h"
+#include "pico/stdlib.h"    // time_us_64
+#include "hardware/sync.h"  // __dmb
+
+
+// Relógio em software: instante UTC (segundos Unix) ancorado no timer de 64 bits
+// do RP2040 no momento em que uma fonte externa (GPRMC do GPS) informou a hora.
+// Escrito só pelo core0 (parser do GPS) e lido pelos dois cores (get_fattime e
+// rotação do logger no core1): a âncora é publicada com um contador de
+// sequência, ímpar durante a escrita. O leitor repete a cópia se o contador
+// mudou no meio, então nunca vê um anchor_us de 64 bits pela metade. Nenhuma
+// função é chamada de interrupção (um leitor ali giraria para sempre sobre uma
+// escrita interrompida no mesmo core).
+static volatile uint32_t anchor_seq = 0;
+static volatile bool time_valid = false;
+static volatile uint32_t anchor_unix = 0;  // Segundos Unix na âncora
+static volatile uint64_t anchor_us = 0;    // time_us_64() na âncora
+
+// Data usada enquanto não há fonte de hora (valor fixo anterior do get_fattime)
+static const utc_time_t fallback_time = { 2025, 7, 9, 16, 45, 0 };
+
+
+// Dias desde 1970-01-01 para uma data civil (algoritmo de H. Hinnant)
+static int32_t days_from_civil(int32_t y, uint32_t m, uint32_t d) {
+    y -= m <= 2;
+    int32_t era = (y >= 0 ? y : y - 399) / 400;
+    uint32_t yoe = (uint32_t)(y - era * 400);
+    uint32_t doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (int32_t)doe - 719468;
+}
+
+// Data civil para dias desde 1970-01-01 (inverso de days_from_civil)
+static void civil_from_days(int32_t z, utc_time_t *utc) {
+    z += 719468;
+    int32_t era = (z >= 0 ? z : z - 146096) / 146097;
+    uint32_t doe = (uint32_t)(z - era * 146097);
+    uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    uint32_t mp = (5 * doy + 2) / 153;
+    uint32_t m = mp < 10 ? mp + 3 : mp - 9;
+    utc->year = (uint16_t)((int32_t)yoe + era * 400 + (m <= 2));
+    utc->month = (uint8_t)m;
+    utc->day = (uint8_t)(doy - (153 * mp + 2) / 5 + 1);
+}
+
+
+// Cópia consistente da âncora; false enquanto o relógio não foi ajustado
+static bool time_anchor(uint32_t *unix_s, uint64_t *us) {
+    uint32_t seq;
+    bool valid;
+    do {
+        seq = anchor_seq;
+        __dmb(); // lê a âncora só depois do contador
+        valid = time_valid;
+        *unix_s = anchor_unix;
+        *us = anchor_us;
+        __dmb(); // âncora lida antes de conferir o contador de novo
+    } while ((seq & 1) || seq != anchor_seq);
+    return valid;
+}
+
+
+// Ajusta o relógio (chamado a cada GPRMC com data/hora, só no core0)
+void time_service_set(const utc_time_t *utc) {
+    int32_t days = days_from_civil(utc->year, utc->month, utc->day);
+    uint32_t unix_s = (uint32_t)days * 86400u + utc->hour * 3600u + utc->min * 60u + utc->sec;
+    uint64_t now = time_us_64();
+
+    anchor_seq = anchor_seq + 1; // ímpar: escrita em andamento
+    __dmb();
+    anchor_unix = unix_s;
+    anchor_us = now;
+    __dmb(); // âncora completa antes de marcar o relógio como válido
+    time_valid = true;
+    __dmb();
+    anchor_seq = anchor_seq + 1;
+}
+
+// true depois que alguma fonte informou a hora
+bool time_service_valid(void) {
+    return time_valid;
+}
+
+// Segundos Unix atuais (0 se o relógio ainda não foi ajustado)
+uint32_t time_service_unix(void) {
+    uint32_t unix_s;
+    uint64_t us;
+    if (!time_anchor(&unix_s, &us)) return 0;
+    return unix_s + (uint32_t)((time_us_64() - us) / 1000000u);
+}
+
+// Data/hora civil de um instante em segundos Unix (ex.: a hora de um registro)
+void time_service_civil(uint32_t unix_s, utc_time_t *utc) {
+    civil_from_days((int32_t)(unix_s / 86400u), utc);
+    unix_s %= 86400u;
+    utc->hour = (uint8_t)(unix_s / 3600u);
+    utc->min = (uint8_t)((unix_s % 3600u) / 60u);
+    utc->sec = (uint8_t)(unix_s % 60u);
+}
+
+// Data/hora atual; devolve false (e a data fixa de reserva) sem fonte de hora
+bool time_service_now(utc_time_t *utc) {
+    uint32_t t = time_service_unix();
+    if (t == 0) {
+        *utc = fallback_time;
+        return false;
+    }
+    time_service_civil(t, utc);
+    return true;
+}
+
+// Data/hora no formato empacotado do FatFs (usado por get_fattime)
+uint32_t time_service_fattime(void) {
+    utc_time_t utc;
+    time_service_now(&utc);
+    return ((uint32_t)(utc.year - 1980) << 25) // Ano desde 1980
+         | ((uint32_t)utc.month << 21)          // Mês
+         | ((uint32_t)utc.day << 16)            // Dia
+         | ((uint32_t)utc.hour << 11)           // Hora
+         | ((uint32_t)utc.min << 5)             // Minuto
+         | ((uint32_t)utc.sec >> 1);            // Segundos/2
+}
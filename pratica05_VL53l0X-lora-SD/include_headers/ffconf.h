@@ -4,6 +4,15 @@
 
 #define FFCONF_DEF	5380	/* Revision ID */
 
+#ifndef FF_FS_PROFILE_EXFAT
+#define FF_FS_PROFILE_EXFAT	0
+#endif
+/* Perfil para cartões grandes (SDXC de 64 GB ou mais, formatados de fábrica em
+/  exFAT com clusters de 128 KiB ou mais). 1 (definido no CMake): exFAT + nomes
+/  longos com buffer na pilha (sem heap e seguro com os dois cores usando o FatFs;
+/  o buffer estático do FF_USE_LFN 1 não é reentrante), nomes de até FF_MAX_LFN
+/  caracteres e página de código 850 (src_/ffunicode.c). 0: FAT12/16/32 e nomes 8.3. */
+
 /*---------------------------------------------------------------------------/
 / Function Configurations
 /---------------------------------------------------------------------------*/
@@ -30,15 +39,17 @@
 /  f_findnext(). (0:Disable, 1:Enable 2:Enable with matching altname[] too) */
 
 
-#define FF_USE_MKFS		0
+#ifndef FF_USE_MKFS
+#define FF_USE_MKFS		0	/* As ferramentas de PC (host_tools) definem 1 para formatar discos em RAM */
+#endif
 /* This option switches f_mkfs(). (0:Disable or 1:Enable) */
 
 
-#define FF_USE_FASTSEEK	0
+#define FF_USE_FASTSEEK	1
 /* This option switches fast seek feature. (0:Disable or 1:Enable) */
 
 
-#define FF_USE_EXPAND	0
+#define FF_USE_EXPAND	1
 /* This option switches f_expand(). (0:Disable or 1:Enable) */
 
 
@@ -84,7 +95,11 @@
 / Locale and Namespace Configurations
 /---------------------------------------------------------------------------*/
 
+#if FF_FS_PROFILE_EXFAT
+#define FF_CODE_PAGE	850
+#else
 #define FF_CODE_PAGE	932
+#endif
 /* This option specifies the OEM code page to be used on the target system.
 /  Incorrect code page setting can cause a file open failure.
 /
@@ -113,8 +128,13 @@
 */
 
 
+#if FF_FS_PROFILE_EXFAT
+#define FF_USE_LFN		2
+#define FF_MAX_LFN		64	/* Pilha por chamada: (64 + 1) * 2 + 7 * 32 bytes com exFAT */
+#else
 #define FF_USE_LFN		0
 #define FF_MAX_LFN		255
+#endif
 /* The FF_USE_LFN switches the support for LFN (long file name).
 /
 /   0: Disable LFN. FF_MAX_LFN has no effect.
@@ -145,7 +165,11 @@
 /  When LFN is not enabled, this option has no effect. */
 
 
+#if FF_FS_PROFILE_EXFAT
+#define FF_LFN_BUF		FF_MAX_LFN	/* FILINFO na pilha do core1 (varredura de diretório) */
+#else
 #define FF_LFN_BUF		255
+#endif
 #define FF_SFN_BUF		12
 /* This set of options defines size of file name members in the FILINFO structure
 /  which is used to read out directory items. These values should be suffcient for
@@ -231,7 +255,7 @@
 /  buffer in the filesystem object (FATFS) is used for the file data transfer. */
 
 
-#define FF_FS_EXFAT		0
+#define FF_FS_EXFAT		FF_FS_PROFILE_EXFAT
 /* This option switches support for exFAT filesystem. (0:Disable or 1:Enable)
 /  To enable exFAT, also LFN needs to be enabled. (FF_USE_LFN >= 1)
 /  Note that enabling exFAT discards ANSI C (C89) compatibility. */
@@ -275,8 +299,12 @@
 /      lock control is independent of re-entrancy. */
 
 
-#define FF_FS_REENTRANT	0
+#define FF_FS_REENTRANT	1
 #define FF_FS_TIMEOUT	1000
+/* Re-entrância ligada: o logger (core1) e leitores/exportadores (core0) acessam o
+/  mesmo volume. ff_mutex_*() estão em ffsystem.c (mutexes do pico_sync) e o
+/  FF_FS_TIMEOUT é contado em milissegundos. FF_FS_LOCK continua 0 porque o leitor
+/  abre o arquivo em uso pelo logger, o que o controle de arquivos recusaria. */
 /* The option FF_FS_REENTRANT switches the re-entrancy (thread safe) of the FatFs
 /  module itself. Note that regardless of this option, file access to different
 /  volume is always re-entrant and volume control functions, f_mount(), f_mkfs()
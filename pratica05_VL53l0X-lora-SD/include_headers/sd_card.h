@@ -2,9 +2,11 @@
 #define SD_CARD_H
 
 #include <stdio.h>
+#include <stdint.h>
 
 extern void init_spi_sdcard();
-extern void write_to_sd(char *text);
+extern void write_to_sd(int distancia_mm);
 extern void read_from_sd();
+extern void read_tail_from_sd(unsigned int n);
 
 #endif
\ No newline at end of file
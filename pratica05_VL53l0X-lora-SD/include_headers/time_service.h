@@ -0,0 +1,32 @@
+#ifndef TIME_SERVICE_H
+#define TIME_SERVICE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Data/hora civil em UTC
+typedef struct {
+    uint16_t year;  // ex.: 2025
+    uint8_t month;  // 1..12
+    uint8_t day;    // 1..31
+    uint8_t hour;   // 0..23
+    uint8_t min;    // 0..59
+    uint8_t sec;    // 0..59
+} utc_time_t;
+
+extern void time_service_set(const utc_time_t *utc);
+extern bool time_service_valid(void);
+extern bool time_service_now(utc_time_t *utc);
+extern uint32_t time_service_unix(void);
+extern uint32_t time_service_fattime(void);
+extern void time_service_civil(uint32_t unix_s, utc_time_t *utc);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
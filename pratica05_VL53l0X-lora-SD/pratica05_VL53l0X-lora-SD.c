@@ -1,6 +1,12 @@
 #include "sensor_VL53L0X.h"
 #include "sd_card.h"
 #include "buzzer.h"
+#include "log_service.h" // Contadores do serviço de log no core1
+#include "flash_store.h" // Contadores do estágio na flash
+#include "sd_diskio.h" // Estatísticas de latência do cartão
+
+#define SD_STATS_INTERVAL_MS 60000 // Intervalo do relatório de latências do SD
+#define SD_READBACK_RECORDS 4      // Registros do fim do arquivo relidos no relatório
 
 
 int main()
@@ -73,10 +79,8 @@ int main()
 
                 play_alerta_cm(); // Toca som de alerta com o buzzer
 
-                // ### Escreve os dados no SDCard
-                write_to_sd(text);
-                // ### Lendo dados do SD
-                read_from_sd();
+                // ### Escreve o alerta no SDCard (registro binário)
+                write_to_sd(distancia);
             }
             // Atualiza estado anterior da detecção
             last_detect = detected;
@@ -87,6 +91,14 @@ int main()
             printf(" === Medição inválida ===");
             printf("\n===========================\n");
         }
+        // Latências do SD, contadores do serviço de log (core1) e da flash no serial,
+        // e a releitura dos últimos registros que chegaram ao cartão
+        if (disk_lat_dump_periodic(SD_STATS_INTERVAL_MS)) {
+            log_service_dump();
+            flash_store_dump();
+            read_tail_from_sd(SD_READBACK_RECORDS);
+        }
+
         // Espera 500ms entre leituras
         sleep_ms(500);
     }
@@ -1,224 +1,401 @@
-#include <stdio.h>
-#include "pico/stdlib.h"
-#include "hardware/spi.h"
 #include "ff.h"
 #include "diskio.h"
+#include "sd_diskio.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h" // time_us_64 (medição de latências)
 
-#define SD_SPI_PORT spi0
-#define SD_PIN_MISO 16
-#define SD_PIN_CS   28
-#define SD_PIN_SCK  18
-#define SD_PIN_MOSI 19
+// Camada comum do diskio: cache de setores e despacho para o backend do drive 0
+
+#ifndef DISKIO_DEFAULT_BACKEND
+#define DISKIO_DEFAULT_BACKEND sd_spi_backend // Cartão SD por SPI (firmware)
+#endif
+extern const disk_backend_t DISKIO_DEFAULT_BACKEND;
 
 #define SD_BLOCK_SIZE 512
 
 static volatile DSTATUS Stat = STA_NOINIT;
-static int is_sdhc = 0; // flag para indicar cartão SDHC/SDXC (endereçamento em LBA)
+static const disk_backend_t *backend = &DISKIO_DEFAULT_BACKEND; // Meio físico do drive 0
+
+#if DISK_CACHE_SECTORS > 0
+// Linha do cache de setores
+typedef struct {
+    LBA_t sector;    // Setor armazenado na linha
+    uint32_t stamp;  // Último uso (LRU)
+    bool valid;      // Linha contém dados
+    bool dirty;      // Linha alterada e ainda não gravada no cartão
+    bool pinned;     // Setor de metadados (FAT/diretório): evitado na evicção
+    BYTE data[SD_BLOCK_SIZE];
+} cache_line_t;
+
+static cache_line_t cache[DISK_CACHE_SECTORS];
+static uint32_t cache_clock = 0; // Relógio lógico para o LRU
+static struct { LBA_t start, count; } pin_ranges[DISK_CACHE_MAX_PIN_RANGES];
+static int pin_range_count = 0;
+#endif
+#if DISK_READAHEAD_SECTORS > 0
+// Leitura antecipada: setores consecutivos ao último lido, trazidos num comando
+static BYTE ra_buf[DISK_READAHEAD_SECTORS * SD_BLOCK_SIZE];
+static LBA_t ra_start = 0; // Primeiro setor em ra_buf
+static UINT ra_count = 0;  // Setores válidos em ra_buf (0 = vazio)
+static LBA_t ra_next = 0;  // Setor que continua a última leitura (detecção de sequência)
+#endif
+static disk_cache_stats_t cache_stats;
 
-static void sd_select(void) {
-    gpio_put(SD_PIN_CS, 0);
+#if DISK_LAT_STATS
+static disk_lat_stats_t lat_stats;
+static LBA_t lat_sector = 0;      // Setor da operação em curso (contexto das amostras)
+static uint64_t lat_last_dump_us = 0;
+#endif
+
+// Troca o meio físico do drive 0 (antes do f_mount)
+void disk_set_backend(const disk_backend_t *new_backend) {
+    backend = new_backend;
+    Stat = STA_NOINIT;
 }
 
-static void sd_deselect(void) {
-    gpio_put(SD_PIN_CS, 1);
-    spi_write_read_blocking(SD_SPI_PORT, (uint8_t[]){0xFF}, NULL, 1);
+DSTATUS disk_initialize(BYTE pdrv) {
+    if (pdrv != 0) return STA_NOINIT;
+
+#if DISK_READAHEAD_SECTORS > 0
+    ra_count = 0; // cartão pode ter sido trocado
+#endif
+
+    if (backend->initialize() != 0) return STA_NOINIT;
+
+    Stat &= ~STA_NOINIT;
+    return Stat;
 }
 
-static uint8_t spi_transfer(uint8_t data) {
-    uint8_t rx;
-    spi_write_read_blocking(SD_SPI_PORT, &data, &rx, 1);
-    return rx;
+DSTATUS disk_status(BYTE pdrv) {
+    if (pdrv == 0) return Stat;
+    return STA_NOINIT;
 }
 
-static uint8_t sd_wait_ready(void) {
-    uint8_t res;
-    for (int i = 0; i < 500; i++) {
-        res = spi_transfer(0xFF);
-        if (res == 0xFF) return 1;
-        sleep_us(1000);
+
+// ==========================
+// Latências: histograma log2 por fase e pior amostra com contexto
+// ==========================
+#if DISK_LAT_STATS
+void disk_lat_record(disk_lat_phase_t phase, uint32_t us) {
+    disk_lat_hist_t *h = &lat_stats.phase[phase];
+    uint32_t b = 0;
+    for (uint32_t v = us >> 1; v && b < DISK_LAT_BUCKETS - 1; v >>= 1) b++;
+
+    h->count++;
+    h->total_us += us;
+    h->buckets[b]++;
+    if (us >= h->max_us) {
+        h->max_us = us;
+        h->max_sector = lat_sector;
+        h->max_t_ms = (uint32_t)(time_us_64() / 1000u);
     }
-    return 0;
 }
 
-static void sd_send_clock_train(void) {
-    sd_deselect();
-    for (int i = 0; i < 10; i++) {
-        spi_transfer(0xFF);
+void disk_lat_get_stats(disk_lat_stats_t *stats) {
+    *stats = lat_stats;
+}
+
+void disk_lat_reset_stats(void) {
+    memset(&lat_stats, 0, sizeof(lat_stats));
+}
+
+// Imprime contagem, média, pior caso e as faixas não vazias de cada fase
+void disk_lat_dump(void) {
+    static const char *const names[DISK_LAT_PHASES] = { "cmd", "token", "xfer", "busy", "read", "write", "sync" };
+
+    printf("\nLatências do cartão (us) - faixas log2 [2^i, 2^(i+1)):\n");
+    for (int p = 0; p < DISK_LAT_PHASES; p++) {
+        const disk_lat_hist_t *h = &lat_stats.phase[p];
+        if (!h->count) continue;
+        printf("%-5s n=%lu média=%lu máx=%lu (setor %lu, %lu ms) |", names[p],
+               (unsigned long)h->count, (unsigned long)(h->total_us / h->count), (unsigned long)h->max_us,
+               (unsigned long)h->max_sector, (unsigned long)h->max_t_ms);
+        for (int b = 0; b < DISK_LAT_BUCKETS; b++) {
+            if (h->buckets[b]) printf(" %lu:%lu", 1UL << b, (unsigned long)h->buckets[b]);
+        }
+        printf("\n");
     }
 }
 
-static uint8_t sd_command(uint8_t cmd, uint32_t arg) {
-    uint8_t crc = 0x01;
-    uint8_t res;
+// Chamar no loop principal: imprime as estatísticas a cada interval_ms
+bool disk_lat_dump_periodic(uint32_t interval_ms) {
+    uint64_t now = time_us_64();
+    if (now - lat_last_dump_us < (uint64_t)interval_ms * 1000u) return false;
+    lat_last_dump_us = now;
+    disk_lat_dump();
+    return true;
+}
+#else
+void disk_lat_get_stats(disk_lat_stats_t *stats) { memset(stats, 0, sizeof(*stats)); }
+void disk_lat_reset_stats(void) {}
+void disk_lat_dump(void) {}
+bool disk_lat_dump_periodic(uint32_t interval_ms) { (void)interval_ms; return false; }
+#endif
 
-    if (cmd == 0) crc = 0x95;
-    if (cmd == 8) crc = 0x87;
+// Chamadas ao backend medidas como READ/WRITE (o backend registra as fases internas)
+static DRESULT backend_read(BYTE *buff, LBA_t sector, UINT count) {
+#if DISK_LAT_STATS
+    lat_sector = sector;
+    uint64_t t0 = time_us_64();
+    DRESULT res = backend->read(buff, sector, count);
+    disk_lat_record(DISK_LAT_READ, (uint32_t)(time_us_64() - t0));
+    return res;
+#else
+    return backend->read(buff, sector, count);
+#endif
+}
 
-    sd_deselect();
-    sd_select();
+static DRESULT backend_write(const BYTE *buff, LBA_t sector, UINT count) {
+#if DISK_LAT_STATS
+    lat_sector = sector;
+    uint64_t t0 = time_us_64();
+    DRESULT res = backend->write(buff, sector, count);
+    disk_lat_record(DISK_LAT_WRITE, (uint32_t)(time_us_64() - t0));
+    return res;
+#else
+    return backend->write(buff, sector, count);
+#endif
+}
 
-    if (!sd_wait_ready()) {
-        sd_deselect();
-        return 0xFF;
-    }
 
-    spi_transfer(0x40 | cmd);
-    spi_transfer((uint8_t)(arg >> 24));
-    spi_transfer((uint8_t)(arg >> 16));
-    spi_transfer((uint8_t)(arg >> 8));
-    spi_transfer((uint8_t)arg);
-    spi_transfer(crc);
+// ==========================
+// Cache de setores write-back com LRU
+// ==========================
+#if DISK_CACHE_SECTORS > 0
+static bool cache_is_meta(LBA_t sector) {
+    for (int i = 0; i < pin_range_count; i++) {
+        if (sector >= pin_ranges[i].start && sector - pin_ranges[i].start < pin_ranges[i].count) return true;
+    }
+    return false;
+}
 
-    for (int i = 0; i < 10; i++) {
-        res = spi_transfer(0xFF);
-        if (!(res & 0x80)) return res;
+static cache_line_t *cache_find(LBA_t sector) {
+    for (int i = 0; i < DISK_CACHE_SECTORS; i++) {
+        if (cache[i].valid && cache[i].sector == sector) return &cache[i];
     }
-    return 0xFF;
+    return NULL;
 }
 
-static uint8_t sd_acmd(uint8_t cmd, uint32_t arg) {
-    uint8_t res = sd_command(55, 0);
-    if (res > 1) return res;
-    return sd_command(cmd, arg);
+static DRESULT cache_writeback(cache_line_t *line) {
+    if (!line->dirty) return RES_OK;
+    DRESULT res = backend_write(line->data, line->sector, 1);
+    if (res != RES_OK) return res;
+    line->dirty = false;
+    cache_stats.writebacks++;
+    return RES_OK;
 }
 
-DSTATUS disk_initialize(BYTE pdrv) {
-    if (pdrv != 0) return STA_NOINIT;
+// Escolhe uma linha para o setor: livre, ou a menos usada não fixada.
+// Setores de metadados só ocupam até metade do cache como fixados.
+static cache_line_t *cache_alloc(LBA_t sector) {
+    cache_line_t *victim = NULL;
+    int pinned = 0;
+
+    // Percorre o cache todo: os fixados depois de uma linha livre também contam
+    for (int i = 0; i < DISK_CACHE_SECTORS; i++) {
+        if (!cache[i].valid) {
+            if (!victim || victim->valid) victim = &cache[i];
+            continue;
+        }
+        if (cache[i].pinned) { pinned++; continue; }
+        if (!victim || (victim->valid && cache[i].stamp < victim->stamp)) victim = &cache[i];
+    }
+    if (!victim) return NULL; // tudo fixado: acesso vai direto ao cartão
+
+    if (victim->valid) {
+        if (cache_writeback(victim) != RES_OK) return NULL;
+        cache_stats.evictions++;
+    }
+    victim->sector = sector;
+    victim->valid = true;
+    victim->dirty = false;
+    victim->pinned = cache_is_meta(sector) && pinned < DISK_CACHE_SECTORS / 2;
+    return victim;
+}
 
-    spi_init(SD_SPI_PORT, 1000 * 1000);
-    gpio_set_function(SD_PIN_MISO, GPIO_FUNC_SPI);
-    gpio_set_function(SD_PIN_MOSI, GPIO_FUNC_SPI);
-    gpio_set_function(SD_PIN_SCK, GPIO_FUNC_SPI);
-    gpio_init(SD_PIN_CS);
-    gpio_set_dir(SD_PIN_CS, GPIO_OUT);
-    gpio_put(SD_PIN_CS, 1);
-
-    sd_send_clock_train();
-
-    uint8_t res;
-
-    res = sd_command(0, 0); // CMD0
-    printf("CMD0 response: 0x%02X\n", res);
-    if (res != 1) return STA_NOINIT;
-
-    res = sd_command(8, 0x1AA); // CMD8
-    printf("CMD8 response: 0x%02X\n", res);
-
-    if (res == 1) {
-        // SD v2+
-        for (int i = 0; i < 4; i++) spi_transfer(0xFF); // lê 4 bytes da resposta do CMD8
-
-        int timeout = 1000;
-        do {
-            res = sd_acmd(41, 0x40000000);
-            printf("ACMD41 response: 0x%02X\n", res);
-            sleep_ms(1);
-            if (--timeout == 0) break;
-        } while (res != 0);
-
-        if (res != 0) return STA_NOINIT;
-
-        res = sd_command(58, 0);
-        printf("CMD58 response: 0x%02X\n", res);
-        if (res != 0) return STA_NOINIT;
-
-        uint8_t ocr[4];
-        for (int i = 0; i < 4; i++) ocr[i] = spi_transfer(0xFF);
-        // Verifica se é SDHC (bit 6 do primeiro byte da OCR)
-        if (ocr[0] & 0x40) {
-            is_sdhc = 1;
-            printf("Cartão SDHC/SDXC detectado\n");
-        } else {
-            is_sdhc = 0;
-            printf("Cartão SDSC detectado\n");
+static DRESULT cache_flush(void) {
+    for (int i = 0; i < DISK_CACHE_SECTORS; i++) {
+        if (cache[i].valid) {
+            DRESULT res = cache_writeback(&cache[i]);
+            if (res != RES_OK) return res;
         }
-    } else {
-        // SD v1 ou MMC fallback
-        int timeout = 1000;
-        do {
-            res = sd_acmd(41, 0);
-            printf("ACMD41 fallback response: 0x%02X\n", res);
-            sleep_ms(1);
-            if (--timeout == 0) break;
-        } while (res != 0);
+    }
+    return RES_OK;
+}
+
+// Faixa de setores tratada como metadados (ex.: FAT e diretório raiz)
+void disk_cache_pin_range(LBA_t start, LBA_t count) {
+    if (pin_range_count < DISK_CACHE_MAX_PIN_RANGES) {
+        pin_ranges[pin_range_count].start = start;
+        pin_ranges[pin_range_count].count = count;
+        pin_range_count++;
+    }
+}
+
+void disk_cache_clear_pins(void) {
+    pin_range_count = 0;
+    for (int i = 0; i < DISK_CACHE_SECTORS; i++) cache[i].pinned = false;
+}
+#else
+void disk_cache_pin_range(LBA_t start, LBA_t count) { (void)start; (void)count; }
+void disk_cache_clear_pins(void) {}
+#endif
 
-        if (res != 0) return STA_NOINIT;
 
-        is_sdhc = 0;
+// ==========================
+// Leitura antecipada (read-ahead) de setores consecutivos
+// ==========================
+// Um dump do log faz o FatFs pedir um setor por vez (CMD17 + espera do token a
+// cada um). Quando um setor continua o anterior, um único comando de vários
+// blocos traz ele e os seguintes para ra_buf. ra_buf acompanha toda escrita,
+// então sempre contém o conteúdo atual dos setores.
+#if DISK_READAHEAD_SECTORS > 0
+static bool ra_lookup(BYTE *buff, LBA_t sector) {
+    if (sector < ra_start || sector - ra_start >= ra_count) return false;
+    memcpy(buff, &ra_buf[(sector - ra_start) * SD_BLOCK_SIZE], SD_BLOCK_SIZE);
+    cache_stats.readahead_hits++;
+    return true;
+}
+
+static DRESULT ra_fill(BYTE *buff, LBA_t sector) {
+    ra_count = 0;
+    DRESULT res = backend_read(ra_buf, sector, DISK_READAHEAD_SECTORS);
+    if (res != RES_OK) return res; // ex.: além do fim do cartão; o chamador lê só o setor
+#if DISK_CACHE_SECTORS > 0
+    for (UINT i = 0; i < DISK_READAHEAD_SECTORS; i++) { // linhas em cache são mais novas
+        cache_line_t *line = cache_find(sector + i);
+        if (line) memcpy(&ra_buf[i * SD_BLOCK_SIZE], line->data, SD_BLOCK_SIZE);
     }
+#endif
+    ra_start = sector;
+    ra_count = DISK_READAHEAD_SECTORS;
+    cache_stats.readahead_fills++;
+    memcpy(buff, ra_buf, SD_BLOCK_SIZE);
+    return RES_OK;
+}
 
-    Stat &= ~STA_NOINIT;
-    return Stat;
+static void ra_update(const BYTE *buff, LBA_t sector, UINT count) {
+    for (UINT i = 0; i < count; i++) {
+        if (sector + i >= ra_start && sector + i - ra_start < ra_count) {
+            memcpy(&ra_buf[(sector + i - ra_start) * SD_BLOCK_SIZE], buff + i * SD_BLOCK_SIZE, SD_BLOCK_SIZE);
+        }
+    }
 }
+#endif
 
-DSTATUS disk_status(BYTE pdrv) {
-    if (pdrv == 0) return Stat;
-    return STA_NOINIT;
+void disk_cache_get_stats(disk_cache_stats_t *stats) {
+    *stats = cache_stats;
+}
+
+void disk_cache_reset_stats(void) {
+    memset(&cache_stats, 0, sizeof(cache_stats));
 }
 
+
 DRESULT disk_read(BYTE pdrv, BYTE *buff, LBA_t sector, UINT count) {
     if (pdrv != 0 || !count) return RES_PARERR;
     if (Stat & STA_NOINIT) return RES_NOTRDY;
 
-    while (count--) {
-        uint32_t address = is_sdhc ? sector : sector * SD_BLOCK_SIZE;
-
-        if (sd_command(17, address) != 0) return RES_ERROR;
-
-        // Aguarda token 0xFE com timeout
-        int timeout = 10000;
-        uint8_t token;
-        do {
-            token = spi_transfer(0xFF);
-            if (token == 0xFE) break;
-            sleep_us(10);
-        } while (--timeout);
-
-        if (token != 0xFE) return RES_ERROR;
+#if DISK_READAHEAD_SECTORS > 0
+    bool sequential = (sector == ra_next);
+    ra_next = sector + count;
+    if (count == 1 && ra_lookup(buff, sector)) return RES_OK;
+#endif
 
-        for (int i = 0; i < SD_BLOCK_SIZE; i++) {
-            buff[i] = spi_transfer(0xFF);
+#if DISK_CACHE_SECTORS > 0
+    if (count > 1) {
+        // Leitura longa vai direto ao cartão; linhas em cache (mais novas) sobrepõem
+        DRESULT res = backend_read(buff, sector, count);
+        if (res != RES_OK) return res;
+        cache_stats.read_misses += count;
+        for (UINT i = 0; i < count; i++) {
+            cache_line_t *line = cache_find(sector + i);
+            if (line) memcpy(buff + i * SD_BLOCK_SIZE, line->data, SD_BLOCK_SIZE);
         }
-        buff += SD_BLOCK_SIZE;
-
-        spi_transfer(0xFF); // CRC
-        spi_transfer(0xFF);
-        sector++;
+        return RES_OK;
     }
 
+    cache_line_t *line = cache_find(sector);
+    if (line) {
+        cache_stats.read_hits++;
+    } else {
+        cache_stats.read_misses++;
+#if DISK_READAHEAD_SECTORS > 0
+        // Em sequência os setores vão para ra_buf sem ocupar linhas do cache
+        if (sequential && ra_fill(buff, sector) == RES_OK) return RES_OK;
+#endif
+        line = cache_alloc(sector);
+        if (!line) return backend_read(buff, sector, 1);
+        DRESULT res = backend_read(line->data, sector, 1);
+        if (res != RES_OK) { line->valid = false; return res; }
+    }
+    line->stamp = ++cache_clock;
+    memcpy(buff, line->data, SD_BLOCK_SIZE);
     return RES_OK;
+#else
+#if DISK_READAHEAD_SECTORS > 0
+    if (count == 1 && sequential && ra_fill(buff, sector) == RES_OK) return RES_OK;
+#endif
+    return backend_read(buff, sector, count);
+#endif
 }
 
 #if FF_FS_READONLY == 0
+// Escrita direta no cartão. ra_update já copiou buff para a leitura antecipada:
+// se o cartão recusar, ela é descartada para não servir dados que não chegaram lá.
+static DRESULT disk_write_direct(const BYTE *buff, LBA_t sector, UINT count) {
+    DRESULT res = backend_write(buff, sector, count);
+#if DISK_READAHEAD_SECTORS > 0
+    if (res != RES_OK) ra_count = 0;
+#endif
+    return res;
+}
+
 DRESULT disk_write(BYTE pdrv, const BYTE *buff, LBA_t sector, UINT count) {
     if (pdrv != 0 || !count) return RES_PARERR;
     if (Stat & STA_NOINIT) return RES_NOTRDY;
 
-    while (count--) {
-        uint32_t address = is_sdhc ? sector : sector * SD_BLOCK_SIZE;
-
-        if (sd_command(24, address) != 0) return RES_ERROR;
-
-        spi_transfer(0xFF);
-        spi_transfer(0xFE);
+#if DISK_READAHEAD_SECTORS > 0
+    ra_update(buff, sector, count);
+#endif
 
-        for (int i = 0; i < SD_BLOCK_SIZE; i++) {
-            spi_transfer(buff[i]);
+#if DISK_CACHE_SECTORS > 0
+    if (count > 1) {
+        // Escrita longa (dados) vai direto. Só depois que o cartão aceitou, as
+        // cópias em cache são atualizadas e ficam limpas; se ele recusar, são
+        // descartadas (o conteúdo no cartão é incerto)
+        cache_stats.write_misses += count;
+        DRESULT res = disk_write_direct(buff, sector, count);
+        for (UINT i = 0; i < count; i++) {
+            cache_line_t *line = cache_find(sector + i);
+            if (!line) continue;
+            if (res == RES_OK) {
+                memcpy(line->data, buff + i * SD_BLOCK_SIZE, SD_BLOCK_SIZE);
+                line->dirty = false;
+            } else {
+                line->valid = false;
+            }
         }
-        buff += SD_BLOCK_SIZE;
-
-        spi_transfer(0xFF);
-        spi_transfer(0xFF);
-
-        uint8_t resp = spi_transfer(0xFF);
-        if ((resp & 0x1F) != 0x05) return RES_ERROR;
-
-        while (spi_transfer(0xFF) == 0) ; // espera fim
-
-        sector++;
+        return res;
     }
 
+    cache_line_t *line = cache_find(sector);
+    if (line) {
+        cache_stats.write_hits++;
+    } else {
+        cache_stats.write_misses++;
+        line = cache_alloc(sector);
+        if (!line) return disk_write_direct(buff, sector, 1);
+    }
+    memcpy(line->data, buff, SD_BLOCK_SIZE);
+    line->dirty = true; // gravado no cartão na evicção ou no CTRL_SYNC
+    line->stamp = ++cache_clock;
     return RES_OK;
+#else
+    return disk_write_direct(buff, sector, count);
+#endif
 }
 #endif
 
@@ -226,17 +403,25 @@ DRESULT disk_ioctl(BYTE pdrv, BYTE cmd, void *buff) {
     if (pdrv != 0) return RES_PARERR;
 
     switch (cmd) {
-    case CTRL_SYNC:
-        return RES_OK;
+    case CTRL_SYNC: { // grava linhas sujas do cache e garante que o meio terminou
+#if DISK_LAT_STATS
+        uint64_t t0 = time_us_64();
+#endif
+        DRESULT res = RES_OK;
+#if DISK_CACHE_SECTORS > 0
+        if (cache_flush() != RES_OK) res = RES_ERROR;
+#endif
+        if (res == RES_OK) res = backend->sync();
+#if DISK_LAT_STATS
+        disk_lat_record(DISK_LAT_SYNC, (uint32_t)(time_us_64() - t0));
+#endif
+        return res;
+    }
     case GET_SECTOR_SIZE:
-        *(WORD *)buff = SD_BLOCK_SIZE;
-        return RES_OK;
     case GET_BLOCK_SIZE:
-        *(DWORD *)buff = 1;
-        return RES_OK;
     case GET_SECTOR_COUNT:
-        *(DWORD *)buff = 32768; // exemplo para cartão 16MB
-        return RES_OK;
+        if (Stat & STA_NOINIT) return RES_NOTRDY;
+        return backend->ioctl(cmd, buff);
     }
 
     return RES_PARERR;
@@ -0,0 +1,39 @@
+#include "ff.h"
+#include "pico/mutex.h"
+
+// Sincronização do FatFs (FF_FS_REENTRANT) com os mutexes do pico_sync.
+// Um mutex por volume e um extra (índice FF_VOLUMES) para o travamento de
+// sistema usado quando FF_FS_LOCK > 0. O dono de um mutex do SDK é o core,
+// então o acesso fica serializado entre core0 e core1. Recursivos: o logger
+// segura o volume em volta de uma sequência de chamadas do FatFs que mexe no
+// estado interno (ex.: dica de alocação + f_expand), e cada chamada trava de novo.
+
+#if FF_FS_REENTRANT
+
+static recursive_mutex_t ff_mutex[FF_VOLUMES + 1];
+
+
+// Cria o objeto de sincronização do volume (chamado por f_mount). 1: ok
+int ff_mutex_create(int vol) {
+    recursive_mutex_init(&ff_mutex[vol]);
+    return 1;
+}
+
+
+// Descarta o objeto de sincronização (f_mount/f_unmount); nada a liberar
+void ff_mutex_delete(int vol) {
+    (void)vol;
+}
+
+
+// Trava o volume, desistindo após FF_FS_TIMEOUT ms (FatFs retorna FR_TIMEOUT). 1: ok
+int ff_mutex_take(int vol) {
+    return recursive_mutex_enter_timeout_ms(&ff_mutex[vol], FF_FS_TIMEOUT) ? 1 : 0;
+}
+
+
+void ff_mutex_give(int vol) {
+    recursive_mutex_exit(&ff_mutex[vol]);
+}
+
+#endif
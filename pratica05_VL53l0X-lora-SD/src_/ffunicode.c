@@ -0,0 +1,133 @@
+#include "ff.h"
+
+// Conversões Unicode do FatFs para o perfil exFAT/LFN (FF_FS_PROFILE_EXFAT).
+// Versão reduzida do ffunicode.c original: só a página de código do perfil
+// (850, Latin 1) e a conversão para maiúsculas do plano básico (BMP), em
+// faixas compactas (~1 KiB de flash em vez das tabelas de todas as páginas).
+
+#if FF_USE_LFN
+
+#if FF_CODE_PAGE != 850
+#error "ffunicode.c reduzido: o perfil exFAT/LFN usa FF_CODE_PAGE 850"
+#endif
+
+// OEM 850 (0x80..0xFF) -> Unicode
+static const WCHAR oem850_uni[128] = {
+	0x00C7, 0x00FC, 0x00E9, 0x00E2, 0x00E4, 0x00E0, 0x00E5, 0x00E7,
+	0x00EA, 0x00EB, 0x00E8, 0x00EF, 0x00EE, 0x00EC, 0x00C4, 0x00C5,
+	0x00C9, 0x00E6, 0x00C6, 0x00F4, 0x00F6, 0x00F2, 0x00FB, 0x00F9,
+	0x00FF, 0x00D6, 0x00DC, 0x00F8, 0x00A3, 0x00D8, 0x00D7, 0x0192,
+	0x00E1, 0x00ED, 0x00F3, 0x00FA, 0x00F1, 0x00D1, 0x00AA, 0x00BA,
+	0x00BF, 0x00AE, 0x00AC, 0x00BD, 0x00BC, 0x00A1, 0x00AB, 0x00BB,
+	0x2591, 0x2592, 0x2593, 0x2502, 0x2524, 0x00C1, 0x00C2, 0x00C0,
+	0x00A9, 0x2563, 0x2551, 0x2557, 0x255D, 0x00A2, 0x00A5, 0x2510,
+	0x2514, 0x2534, 0x252C, 0x251C, 0x2500, 0x253C, 0x00E3, 0x00C3,
+	0x255A, 0x2554, 0x2569, 0x2566, 0x2560, 0x2550, 0x256C, 0x00A4,
+	0x00F0, 0x00D0, 0x00CA, 0x00CB, 0x00C8, 0x0131, 0x00CD, 0x00CE,
+	0x00CF, 0x2518, 0x250C, 0x2588, 0x2584, 0x00A6, 0x00CC, 0x2580,
+	0x00D3, 0x00DF, 0x00D4, 0x00D2, 0x00F5, 0x00D5, 0x00B5, 0x00FE,
+	0x00DE, 0x00DA, 0x00DB, 0x00D9, 0x00FD, 0x00DD, 0x00AF, 0x00B4,
+	0x00AD, 0x00B1, 0x2017, 0x00BE, 0x00B6, 0x00A7, 0x00F7, 0x00B8,
+	0x00B0, 0x00A8, 0x00B7, 0x00B9, 0x00B3, 0x00B2, 0x25A0, 0x00A0,
+};
+
+
+// OEM (página FF_CODE_PAGE) -> Unicode. 0: sem correspondência
+WCHAR ff_oem2uni(WCHAR oem, WORD cp) {
+    if (oem < 0x80) return oem; // ASCII
+    if (cp != FF_CODE_PAGE || oem >= 0x100) return 0;
+    return oem850_uni[oem - 0x80];
+}
+
+
+// Unicode -> OEM (página FF_CODE_PAGE). 0: sem correspondência
+WCHAR ff_uni2oem(DWORD uni, WORD cp) {
+    if (uni < 0x80) return (WCHAR)uni; // ASCII
+    if (cp != FF_CODE_PAGE || uni >= 0x10000) return 0;
+    for (WCHAR i = 0; i < 128; i++) {
+        if (oem850_uni[i] == uni) return (WCHAR)(0x80 + i);
+    }
+    return 0;
+}
+
+
+// Faixas de minúsculas do BMP: [first, first + count). delta é somado em
+// módulo 2^16; delta 0 marca uma faixa de pares (maiúscula par, minúscula ímpar).
+typedef struct {
+    WORD first;
+    WORD count;
+    WORD delta;
+} upper_range_t;
+
+static const upper_range_t upper_ranges[] = {
+	{ 0x0061,  26, 0xFFE0 }, { 0x00E0,  23, 0xFFE0 }, { 0x00F8,   7, 0xFFE0 }, { 0x00FF,   1, 0x0079 },
+	{ 0x0100,  48, 0 }, { 0x0132,   6, 0 }, { 0x0139,  16, 0 }, { 0x014A,  46, 0 },
+	{ 0x0179,   6, 0 }, { 0x0180,   1, 0x00C3 }, { 0x0182,   4, 0 }, { 0x0188,   1, 0xFFFF },
+	{ 0x018C,   1, 0xFFFF }, { 0x0192,   1, 0xFFFF }, { 0x0195,   1, 0x0061 }, { 0x0199,   1, 0xFFFF },
+	{ 0x019A,   1, 0x00A3 }, { 0x019E,   1, 0x0082 }, { 0x01A0,   6, 0 }, { 0x01A8,   1, 0xFFFF },
+	{ 0x01AD,   1, 0xFFFF }, { 0x01B0,   1, 0xFFFF }, { 0x01B3,   4, 0 }, { 0x01B9,   1, 0xFFFF },
+	{ 0x01BD,   1, 0xFFFF }, { 0x01BF,   1, 0x0038 }, { 0x01C5,   1, 0xFFFF }, { 0x01C6,   1, 0xFFFE },
+	{ 0x01C8,   1, 0xFFFF }, { 0x01C9,   1, 0xFFFE }, { 0x01CB,   1, 0xFFFF }, { 0x01CC,   1, 0xFFFE },
+	{ 0x01CD,  16, 0 }, { 0x01DD,   1, 0xFFB1 }, { 0x01DE,  18, 0 }, { 0x01F2,   1, 0xFFFF },
+	{ 0x01F3,   1, 0xFFFE }, { 0x01F5,   1, 0xFFFF }, { 0x01F8,  40, 0 }, { 0x0222,  18, 0 },
+	{ 0x023C,   1, 0xFFFF }, { 0x023F,   2, 0x2A3F }, { 0x0242,   1, 0xFFFF }, { 0x0246,  10, 0 },
+	{ 0x0250,   1, 0x2A1F }, { 0x0251,   1, 0x2A1C }, { 0x0252,   1, 0x2A1E }, { 0x0253,   1, 0xFF2E },
+	{ 0x0254,   1, 0xFF32 }, { 0x0256,   2, 0xFF33 }, { 0x0259,   1, 0xFF36 }, { 0x025B,   1, 0xFF35 },
+	{ 0x025C,   1, 0xA54F }, { 0x0260,   1, 0xFF33 }, { 0x0261,   1, 0xA54B }, { 0x0263,   1, 0xFF31 },
+	{ 0x0265,   1, 0xA528 }, { 0x0266,   1, 0xA544 }, { 0x0268,   1, 0xFF2F }, { 0x0269,   1, 0xFF2D },
+	{ 0x026A,   1, 0xA544 }, { 0x026B,   1, 0x29F7 }, { 0x026C,   1, 0xA541 }, { 0x026F,   1, 0xFF2D },
+	{ 0x0271,   1, 0x29FD }, { 0x0272,   1, 0xFF2B }, { 0x0275,   1, 0xFF2A }, { 0x027D,   1, 0x29E7 },
+	{ 0x0280,   1, 0xFF26 }, { 0x0282,   1, 0xA543 }, { 0x0283,   1, 0xFF26 }, { 0x0287,   1, 0xA52A },
+	{ 0x0288,   1, 0xFF26 }, { 0x0289,   1, 0xFFBB }, { 0x028A,   2, 0xFF27 }, { 0x028C,   1, 0xFFB9 },
+	{ 0x0292,   1, 0xFF25 }, { 0x029D,   1, 0xA515 }, { 0x029E,   1, 0xA512 }, { 0x0345,   1, 0x0054 },
+	{ 0x0370,   4, 0 }, { 0x0377,   1, 0xFFFF }, { 0x037B,   3, 0x0082 }, { 0x03AC,   1, 0xFFDA },
+	{ 0x03AD,   3, 0xFFDB }, { 0x03B1,  17, 0xFFE0 }, { 0x03C2,   1, 0xFFE1 }, { 0x03C3,   9, 0xFFE0 },
+	{ 0x03CC,   1, 0xFFC0 }, { 0x03CD,   2, 0xFFC1 }, { 0x03D0,   1, 0xFFC2 }, { 0x03D1,   1, 0xFFC7 },
+	{ 0x03D5,   1, 0xFFD1 }, { 0x03D6,   1, 0xFFCA }, { 0x03D7,   1, 0xFFF8 }, { 0x03D8,  24, 0 },
+	{ 0x03F0,   1, 0xFFAA }, { 0x03F1,   1, 0xFFB0 }, { 0x03F2,   1, 0x0007 }, { 0x03F3,   1, 0xFF8C },
+	{ 0x03F5,   1, 0xFFA0 }, { 0x03F8,   1, 0xFFFF }, { 0x03FB,   1, 0xFFFF }, { 0x0430,  32, 0xFFE0 },
+	{ 0x0450,  16, 0xFFB0 }, { 0x0460,  34, 0 }, { 0x048A,  54, 0 }, { 0x04C1,  14, 0 },
+	{ 0x04CF,   1, 0xFFF1 }, { 0x04D0,  96, 0 }, { 0x0561,  38, 0xFFD0 }, { 0x1C80,   1, 0xE792 },
+	{ 0x1C81,   1, 0xE793 }, { 0x1C82,   1, 0xE79C }, { 0x1C83,   2, 0xE79E }, { 0x1C85,   1, 0xE79D },
+	{ 0x1C86,   1, 0xE7A4 }, { 0x1C87,   1, 0xE7DB }, { 0x1C88,   1, 0x89C2 }, { 0x1D79,   1, 0x8A04 },
+	{ 0x1D7D,   1, 0x0EE6 }, { 0x1D8E,   1, 0x8A38 }, { 0x1E00, 150, 0 }, { 0x1E9B,   1, 0xFFC5 },
+	{ 0x1EA0,  96, 0 }, { 0x1F00,   8, 0x0008 }, { 0x1F10,   6, 0x0008 }, { 0x1F20,   8, 0x0008 },
+	{ 0x1F30,   8, 0x0008 }, { 0x1F40,   6, 0x0008 }, { 0x1F51,   1, 0x0008 }, { 0x1F53,   1, 0x0008 },
+	{ 0x1F55,   1, 0x0008 }, { 0x1F57,   1, 0x0008 }, { 0x1F60,   8, 0x0008 }, { 0x1F70,   2, 0x004A },
+	{ 0x1F72,   4, 0x0056 }, { 0x1F76,   2, 0x0064 }, { 0x1F78,   2, 0x0080 }, { 0x1F7A,   2, 0x0070 },
+	{ 0x1F7C,   2, 0x007E }, { 0x1FB0,   2, 0x0008 }, { 0x1FBE,   1, 0xE3DB }, { 0x1FD0,   2, 0x0008 },
+	{ 0x1FE0,   2, 0x0008 }, { 0x1FE5,   1, 0x0007 }, { 0x214E,   1, 0xFFE4 }, { 0x2170,  16, 0xFFF0 },
+	{ 0x2184,   1, 0xFFFF }, { 0x24D0,  26, 0xFFE6 }, { 0x2C30,  48, 0xFFD0 }, { 0x2C61,   1, 0xFFFF },
+	{ 0x2C65,   1, 0xD5D5 }, { 0x2C66,   1, 0xD5D8 }, { 0x2C67,   6, 0 }, { 0x2C73,   1, 0xFFFF },
+	{ 0x2C76,   1, 0xFFFF }, { 0x2C80, 100, 0 }, { 0x2CEB,   4, 0 }, { 0x2CF3,   1, 0xFFFF },
+	{ 0x2D00,  38, 0xE3A0 }, { 0x2D27,   1, 0xE3A0 }, { 0x2D2D,   1, 0xE3A0 }, { 0xA640,  46, 0 },
+	{ 0xA680,  28, 0 }, { 0xA722,  14, 0 }, { 0xA732,  62, 0 }, { 0xA779,   4, 0 },
+	{ 0xA77E,  10, 0 }, { 0xA78C,   1, 0xFFFF }, { 0xA790,   4, 0 }, { 0xA794,   1, 0x0030 },
+	{ 0xA796,  20, 0 }, { 0xA7B4,  16, 0 }, { 0xA7C7,   4, 0 }, { 0xA7D1,   1, 0xFFFF },
+	{ 0xA7D6,   4, 0 }, { 0xA7F6,   1, 0xFFFF }, { 0xAB53,   1, 0xFC60 }, { 0xFF41,  26, 0xFFE0 },
+};
+
+#define UPPER_RANGES (sizeof(upper_ranges) / sizeof(upper_ranges[0]))
+
+
+// Unicode -> maiúscula (comparação de nomes e hash de nomes do exFAT).
+// Fora do BMP não há conversão, como no FatFs original.
+DWORD ff_wtoupper(DWORD uni) {
+    if (uni >= 0x10000) return uni;
+
+    // Busca binária pela última faixa com first <= uni
+    UINT lo = 0, hi = UPPER_RANGES;
+    while (lo < hi) {
+        UINT mid = (lo + hi) / 2;
+        if (upper_ranges[mid].first <= uni) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo == 0) return uni;
+
+    const upper_range_t *r = &upper_ranges[lo - 1];
+    if (uni >= (DWORD)r->first + r->count) return uni;
+    if (r->delta == 0) return uni - ((uni - r->first) & 1);
+    return (WORD)(uni + r->delta);
+}
+
+#endif
@@ -0,0 +1,379 @@
+#include "flash_store.h"
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/flash.h"     // flash_safe_execute: trava o outro core durante a operação
+#include "hardware/flash.h" // flash_range_erase/program, FLASH_PAGE_SIZE, FLASH_SECTOR_SIZE
+
+#define FS_MAGIC   0x4C4F4746u // Cabeçalho de página com registros
+#define FS_DRAINED 0x00000000u // Magic da página 0 de um setor já drenado (só zera bits)
+#define FS_ERASED  0xFFFFFFFFu
+
+#define FS_RECS_PER_PAGE    15
+#define FS_PAGES_PER_SECTOR (FLASH_SECTOR_SIZE / FLASH_PAGE_SIZE)
+#define FS_SECTORS          (FLASH_STORE_BYTES / FLASH_SECTOR_SIZE)
+#define FS_OFFSET           (PICO_FLASH_SIZE_BYTES - FLASH_STORE_BYTES) // Deslocamento na flash
+#define FS_LOCK_TIMEOUT_MS  100 // Espera máxima para travar o outro core
+#define FS_LOSS_WINDOW_US   5000 // Perda avisada até esse tempo após um travamento é da flash
+
+#if (FLASH_STORE_BYTES % FLASH_SECTOR_SIZE) != 0 || FLASH_STORE_BYTES < 2 * FLASH_SECTOR_SIZE
+#error "FLASH_STORE_BYTES deve ser múltiplo de 4 KiB (mínimo 2 setores)"
+#endif
+
+// Página gravada de uma vez: posições não usadas ficam em 0xFF (CRC inválido)
+typedef struct {
+    uint32_t magic; // FS_MAGIC; FS_DRAINED na página 0 de um setor drenado
+    uint32_t seq;   // Número de sequência da página (cresce sempre, define a ordem)
+    log_record_t rec[FS_RECS_PER_PAGE];
+    uint8_t pad[FLASH_PAGE_SIZE - 8 - FS_RECS_PER_PAGE * LOG_REC_SIZE];
+} flash_page_t;
+
+_Static_assert(sizeof(flash_page_t) == FLASH_PAGE_SIZE, "flash_page_t deve ocupar uma página");
+
+// Estado do anel. Tudo roda no core1 (serviço de log), exceto flash_store_init.
+static bool ready = false;
+static uint32_t head;      // Setor em escrita
+static uint32_t head_page; // Próxima página do setor em escrita (FS_PAGES_PER_SECTOR = fechado)
+static uint32_t tail;      // Setor mais antigo ainda não drenado
+static uint32_t used;      // Setores com dados não drenados (tail..head)
+static uint32_t seq;       // Sequência da próxima página
+static bool spare_ready;   // Setor seguinte ao head já conferido em branco (apagado)
+
+static flash_page_t page_buf;    // Página em montagem (RAM)
+static uint32_t page_count;      // Registros em page_buf
+static uint32_t page_first_ms;   // Instante do primeiro registro de page_buf
+static bool page_event;          // page_buf tem um evento (grava em FLASH_STORE_EVENT_MS)
+static uint32_t page_event_ms;   // Instante do primeiro evento de page_buf
+static uint32_t sector_first_ms; // Instante da primeira página do setor em escrita
+
+static uint32_t drain_page, drain_slot; // Cursor do dreno dentro do setor tail
+static bool drain_retry = false;
+static uint32_t drain_fail_ms;
+
+static flash_store_stats_t stats;
+
+// Escritos só por um core e lidos pelo outro (palavras de 32 bits: atômicas)
+static volatile uint32_t erase_until_ms; // Fim da janela de apagamento (core0)
+static volatile bool lockout_active;     // Operação na flash em andamento (core1)
+static volatile uint32_t lockout_end_us; // Fim do último travamento (core1)
+static volatile uint32_t lockout_losses; // Perdas avisadas logo após um travamento (core0)
+
+
+static inline uint32_t now_ms(void) {
+    return to_ms_since_boot(get_absolute_time());
+}
+
+// Página mapeada em memória (XIP): leitura direta, sem cópia
+static const flash_page_t *fs_page(uint32_t sector, uint32_t page) {
+    return (const flash_page_t *)(uintptr_t)(XIP_BASE + FS_OFFSET + sector * FLASH_SECTOR_SIZE + page * FLASH_PAGE_SIZE);
+}
+
+static bool fs_blank(const void *p, uint32_t len) {
+    const uint32_t *w = (const uint32_t *)p;
+    for (uint32_t i = 0; i < len / 4; i++) {
+        if (w[i] != FS_ERASED) return false;
+    }
+    return true;
+}
+
+
+// ==========================
+// Operações na flash (XIP desligado: o outro core fica travado em RAM)
+// ==========================
+typedef struct {
+    uint32_t offs;
+    const void *data;
+} fs_op_t;
+
+static void fs_do_erase(void *param) {
+    const fs_op_t *op = (const fs_op_t *)param;
+    flash_range_erase(op->offs, FLASH_SECTOR_SIZE);
+}
+
+static void fs_do_program(void *param) {
+    const fs_op_t *op = (const fs_op_t *)param;
+    flash_range_program(op->offs, (const uint8_t *)op->data, FLASH_PAGE_SIZE);
+}
+
+// Executa a operação com o core0 travado e mede o travamento (inclui a espera
+// pelo outro core, então é um limite superior)
+static bool fs_execute(void (*func)(void *), fs_op_t *op) {
+    uint32_t t0 = time_us_32();
+    lockout_active = true;
+    int rc = flash_safe_execute(func, op, FS_LOCK_TIMEOUT_MS);
+    lockout_end_us = time_us_32();
+    lockout_active = false;
+    if (rc != PICO_OK) return false;
+
+    uint32_t us = lockout_end_us - t0;
+    if (us > stats.lockout_max_us) stats.lockout_max_us = us;
+    stats.lockouts++;
+    return true;
+}
+
+static bool fs_erase(uint32_t sector) {
+    fs_op_t op = { FS_OFFSET + sector * FLASH_SECTOR_SIZE, NULL };
+    if (!fs_execute(fs_do_erase, &op)) return false;
+    stats.erases++;
+    return true;
+}
+
+// data deve estar em RAM (nunca um ponteiro para a própria flash)
+static bool fs_program(uint32_t sector, uint32_t page, const void *data) {
+    fs_op_t op = { FS_OFFSET + sector * FLASH_SECTOR_SIZE + page * FLASH_PAGE_SIZE, data };
+    return fs_execute(fs_do_program, &op);
+}
+
+
+// Apaga a reserva (setor seguinte ao head) antes de ela ser preciso. Só no
+// core1 ocioso (flash_store_poll) e, com FLASH_STORE_ERASE_GATED, só se a janela
+// liberada pelo core0 ainda couber um apagamento típico.
+static void fs_prepare_spare(void) {
+    if (spare_ready) return;
+    uint32_t next = (head + 1) % FS_SECTORS;
+    if (used > 0 && next == tail) return; // anel cheio: espera o dreno liberar o setor
+
+    if (fs_blank(fs_page(next, 0), FLASH_SECTOR_SIZE)) {
+        spare_ready = true;
+        return;
+    }
+#if FLASH_STORE_ERASE_GATED
+    if ((int32_t)(erase_until_ms - now_ms()) < FLASH_STORE_ERASE_MS) return;
+#endif
+    spare_ready = fs_erase(next);
+}
+
+// Passa à reserva (false: anel cheio ou reserva ainda não apagada). Nunca apaga:
+// roda dentro de flash_store_append, e um apagamento travaria o core0 por até 400 ms.
+static bool fs_open_sector(void) {
+    uint32_t next = (head + 1) % FS_SECTORS;
+    if (used > 0 && next == tail) return false;
+
+    if (!spare_ready && !fs_blank(fs_page(next, 0), FLASH_SECTOR_SIZE)) {
+        stats.spare_misses++;
+        return false;
+    }
+
+    head = next;
+    head_page = 0;
+    spare_ready = false;
+    if (used++ == 0) {
+        tail = head;
+        drain_page = drain_slot = 0;
+    }
+    return true;
+}
+
+// Grava page_buf na próxima página livre
+static bool fs_program_page(void) {
+    for (;;) {
+        if (head_page >= FS_PAGES_PER_SECTOR && !fs_open_sector()) return false;
+        // Página parcialmente gravada (queda de energia): pula
+        if (fs_blank(fs_page(head, head_page), FLASH_PAGE_SIZE)) break;
+        head_page++;
+    }
+
+    page_buf.magic = FS_MAGIC;
+    page_buf.seq = seq;
+    if (!fs_program(head, head_page, &page_buf)) return false;
+
+    if (head_page == 0) sector_first_ms = page_first_ms;
+    head_page++;
+    seq++;
+    stats.pages++;
+
+    page_count = 0;
+    page_event = false;
+    memset(&page_buf, 0xFF, sizeof(page_buf));
+    return true;
+}
+
+
+// Copia o setor tail para o SD a partir do cursor, confirma e marca como drenado
+static void fs_drain_tail(flash_store_sink_t sink, flash_store_commit_t commit) {
+    for (; drain_page < FS_PAGES_PER_SECTOR; drain_page++, drain_slot = 0) {
+        const flash_page_t *p = fs_page(tail, drain_page);
+        if (p->magic != FS_MAGIC) continue; // página livre ou pulada
+
+        for (; drain_slot < FS_RECS_PER_PAGE; drain_slot++) {
+            if (!log_record_valid(&p->rec[drain_slot])) continue;
+            if (sink(&p->rec[drain_slot], false) != FR_OK) goto fail;
+            stats.drained++;
+        }
+    }
+    if (commit() != FR_OK) goto fail;
+
+    // Marca o setor zerando o magic da página 0 (programar só zera bits; sem apagar).
+    // Se a marca falhar, o setor é drenado de novo após um reset (registros duplicados).
+    if (fs_page(tail, 0)->magic == FS_MAGIC) {
+        static flash_page_t mark;
+        memcpy(&mark, fs_page(tail, 0), sizeof(mark));
+        mark.magic = FS_DRAINED;
+        fs_program(tail, 0, &mark);
+    }
+
+    used--;
+    tail = (tail + 1) % FS_SECTORS;
+    drain_page = drain_slot = 0;
+    drain_retry = false;
+    return;
+
+fail:
+    stats.drain_errors++;
+    drain_retry = true;
+    drain_fail_ms = now_ms();
+}
+
+
+// ==========================
+// Interface pública
+// ==========================
+
+// Reconstrói o estado do anel a partir da flash (no core0, antes do serviço de log)
+bool flash_store_init(void) {
+    extern char __flash_binary_end;
+    if ((uintptr_t)&__flash_binary_end > XIP_BASE + FS_OFFSET) {
+        printf("Flash store: programa invade a área reservada; desativado\n");
+        return false;
+    }
+    // O core0 precisa aceitar ser travado quando o core1 gravar na flash
+    flash_safe_execute_core_init();
+
+    bool found = false;
+    uint32_t max_seq = 0, min_seq = 0;
+    used = 0;
+    for (uint32_t s = 0; s < FS_SECTORS; s++) {
+        const flash_page_t *p0 = fs_page(s, 0);
+        if (p0->magic != FS_MAGIC && p0->magic != FS_DRAINED) continue;
+
+        if (!found || p0->seq > max_seq) {
+            max_seq = p0->seq;
+            head = s;
+        }
+        if (p0->magic == FS_MAGIC) {
+            if (used == 0 || p0->seq < min_seq) {
+                min_seq = p0->seq;
+                tail = s;
+            }
+            used++;
+        }
+        found = true;
+    }
+
+    if (!found) { // flash nova: o primeiro registro abre o setor 0
+        head = FS_SECTORS - 1;
+        head_page = FS_PAGES_PER_SECTOR;
+        seq = 1;
+    } else if (fs_page(head, 0)->magic == FS_MAGIC) {
+        // Continua no setor em escrita, após a última página gravada
+        head_page = 0;
+        seq = max_seq;
+        while (head_page < FS_PAGES_PER_SECTOR && fs_page(head, head_page)->magic == FS_MAGIC) {
+            seq = fs_page(head, head_page)->seq + 1;
+            head_page++;
+        }
+        sector_first_ms = now_ms() - FLASH_STORE_DRAIN_MS; // dados de antes do reset: drena logo
+    } else {
+        head_page = FS_PAGES_PER_SECTOR;
+        seq = max_seq + FS_PAGES_PER_SECTOR;
+    }
+    if (used == 0) tail = head;
+    drain_page = drain_slot = 0;
+
+    memset(&page_buf, 0xFF, sizeof(page_buf));
+    page_count = 0;
+    page_event = false;
+    spare_ready = false;
+    ready = true;
+
+    printf("Flash store: %u KiB, %lu setor(es) pendente(s) do SD\n",
+           FLASH_STORE_BYTES / 1024, (unsigned long)used);
+    return true;
+}
+
+
+// Anexa um registro (core1). A página de 15 registros é gravada quando enche ou
+// envelhece: FLASH_STORE_PAGE_MS, ou FLASH_STORE_EVENT_MS se tiver um evento
+// (eventos próximos dividem a mesma página em vez de gastar uma cada).
+bool flash_store_append(const log_record_t *rec, bool event) {
+    if (!ready || (page_count == FS_RECS_PER_PAGE && !fs_program_page())) {
+        stats.rejected++;
+        return false;
+    }
+
+    if (page_count == 0) page_first_ms = now_ms();
+    if (event && !page_event) {
+        page_event = true;
+        page_event_ms = now_ms();
+    }
+    page_buf.rec[page_count++] = *rec;
+    stats.staged++;
+
+    if (page_count == FS_RECS_PER_PAGE) fs_program_page();
+    return true;
+}
+
+
+// Chamada periódica (core1, com o anel do serviço vazio): grava páginas antigas,
+// prepara a reserva e drena um setor por chamada. O setor em escrita só é
+// fechado e drenado quando envelhece, para o SD receber lotes grandes.
+void flash_store_poll(flash_store_sink_t sink, flash_store_commit_t commit) {
+    if (!ready) return;
+
+    uint32_t now = now_ms();
+    if (page_count > 0 && (now - page_first_ms >= FLASH_STORE_PAGE_MS ||
+                           (page_event && now - page_event_ms >= FLASH_STORE_EVENT_MS))) {
+        fs_program_page();
+    }
+    fs_prepare_spare();
+
+    if (used == 0) return;
+    if (drain_retry && now - drain_fail_ms < FLASH_STORE_RETRY_MS) return;
+
+    if (tail == head && head_page < FS_PAGES_PER_SECTOR) {
+        if (now - sector_first_ms < FLASH_STORE_DRAIN_MS) return;
+        if (page_count > 0 && !fs_program_page()) return; // a página em RAM vai no lote
+        head_page = FS_PAGES_PER_SECTOR; // fecha o setor; o próximo registro abre outro
+    }
+    fs_drain_tail(sink, commit);
+}
+
+
+// Há registros ainda não drenados (em RAM ou na flash)? Só no core1.
+bool flash_store_pending(void) {
+    return ready && (page_count > 0 || used > 0);
+}
+
+// Core0, ex.: na pausa entre rajadas de uma UART sem folga para um apagamento
+void flash_store_allow_erase(uint32_t window_ms) {
+    erase_until_ms = now_ms() + window_ms;
+}
+
+// Core0, pode ser chamada de uma ISR: um periférico perdeu dados (ex.: estouro
+// da FIFO de uma UART). Com o core0 travado a ISR não roda; ela vê o estouro
+// assim que o travamento acaba, então a perda é atribuída à flash se houver
+// uma operação em andamento ou terminada há menos de FS_LOSS_WINDOW_US.
+void flash_store_note_loss(void) {
+    if (lockout_active || time_us_32() - lockout_end_us < FS_LOSS_WINDOW_US) {
+        lockout_losses = lockout_losses + 1;
+    }
+}
+
+
+void flash_store_get_stats(flash_store_stats_t *out) {
+    *out = stats;
+    out->lockout_losses = lockout_losses;
+    out->used_sectors = used;
+}
+
+void flash_store_dump(void) {
+    printf("Flash store: %lu aceitos, %lu recusados, %lu drenados ao SD, %lu páginas, "
+           "%lu apagamentos, %lu falhas de dreno, %lu/%u setores pendentes\n",
+           (unsigned long)stats.staged, (unsigned long)stats.rejected, (unsigned long)stats.drained,
+           (unsigned long)stats.pages, (unsigned long)stats.erases, (unsigned long)stats.drain_errors,
+           (unsigned long)used, FS_SECTORS);
+    printf("Flash store: core0 travado %lu vez(es), máx. %lu us, %lu perda(s) de periférico logo após; "
+           "%lu página(s) adiada(s) sem reserva apagada\n",
+           (unsigned long)stats.lockouts, (unsigned long)stats.lockout_max_us,
+           (unsigned long)lockout_losses, (unsigned long)stats.spare_misses);
+}
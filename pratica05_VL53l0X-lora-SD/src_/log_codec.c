@@ -0,0 +1,204 @@
+#include "log_codec.h"
+#include <string.h> // memcpy, memset
+
+#define PAYLOAD_BITS ((LOG_CODEC_FRAME_SIZE - LOG_CODEC_HDR_SIZE) * 8)
+#define LIT_BITS     9  // 1 + 8
+#define REF_BITS     13 // 1 + 8 + 4
+#define MIN_MATCH    2
+#define MAX_MATCH    (MIN_MATCH + 15)
+
+
+static void put_u16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static uint16_t get_u16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+// Delta campo a campo (magic/type em XOR, CRC fora, inteiros por subtração)
+static void record_delta(const log_record_t *rec, const log_record_t *prev, uint8_t out[LOG_REC_SIZE]) {
+    log_record_t d;
+    d.magic = rec->magic ^ prev->magic;
+    d.type = rec->type ^ prev->type;
+    d.crc = 0;
+    d.t_ms = rec->t_ms - prev->t_ms;
+    d.a = (int32_t)((uint32_t)rec->a - (uint32_t)prev->a);
+    d.b = (int32_t)((uint32_t)rec->b - (uint32_t)prev->b);
+    memcpy(out, &d, LOG_REC_SIZE);
+}
+
+static void record_undelta(const uint8_t in[LOG_REC_SIZE], const log_record_t *prev, log_record_t *rec) {
+    log_record_t d;
+    memcpy(&d, in, LOG_REC_SIZE);
+    rec->magic = d.magic ^ prev->magic;
+    rec->type = d.type ^ prev->type;
+    rec->t_ms = d.t_ms + prev->t_ms;
+    rec->a = (int32_t)((uint32_t)d.a + (uint32_t)prev->a);
+    rec->b = (int32_t)((uint32_t)d.b + (uint32_t)prev->b);
+    rec->crc = 0;
+    rec->crc = log_crc16(rec, sizeof(*rec));
+}
+
+
+// Escrita de bits no payload, do bit mais significativo para o menos
+static void put_bits(uint8_t *payload, uint32_t *bitpos, uint32_t value, int n) {
+    while (n--) {
+        if ((value >> n) & 1) payload[*bitpos >> 3] |= (uint8_t)(0x80 >> (*bitpos & 7));
+        (*bitpos)++;
+    }
+}
+
+static int get_bits(const uint8_t *payload, uint32_t *bitpos, uint32_t limit, int n) {
+    if (*bitpos + (uint32_t)n > limit) return -1;
+    int v = 0;
+    while (n--) {
+        v = (v << 1) | ((payload[*bitpos >> 3] >> (7 - (*bitpos & 7))) & 1);
+        (*bitpos)++;
+    }
+    return v;
+}
+
+
+// Inicia um quadro vazio em frame (LOG_CODEC_FRAME_SIZE bytes)
+void log_codec_begin(log_codec_t *codec, uint8_t *frame) {
+    memset(frame, 0, LOG_CODEC_FRAME_SIZE);
+    codec->frame = frame;
+    codec->bits = 0;
+    codec->count = 0;
+    codec->pos = 0;
+    memset(&codec->prev, 0, sizeof(codec->prev));
+}
+
+
+// Acrescenta um registro ao quadro. false: não cabe (quadro inalterado; o
+// chamador grava o quadro e começa outro). Busca gulosa na janela inteira:
+// O(16 x 256) comparações por registro no pior caso.
+bool log_codec_put(log_codec_t *codec, const log_record_t *rec) {
+    uint8_t d[LOG_REC_SIZE];
+    record_delta(rec, &codec->prev, d);
+
+    uint8_t *payload = codec->frame + LOG_CODEC_HDR_SIZE;
+    uint32_t bits = codec->bits;
+    uint32_t pos = codec->pos;
+
+    for (uint32_t i = 0; i < LOG_REC_SIZE;) {
+        uint32_t p = pos + i; // posição no fluxo do quadro
+        uint32_t max_len = LOG_REC_SIZE - i;
+        if (max_len > MAX_MATCH) max_len = MAX_MATCH;
+        uint32_t max_dist = p < LOG_CODEC_WINDOW ? p : LOG_CODEC_WINDOW;
+
+        uint32_t best_len = 0, best_dist = 0;
+        for (uint32_t dist = 1; dist <= max_dist && best_len < max_len; dist++) {
+            uint32_t len = 0;
+            while (len < max_len) {
+                // A cópia pode avançar sobre bytes do próprio registro (sequências)
+                uint32_t src = p - dist + len;
+                uint8_t b = src >= pos ? d[src - pos] : codec->window[src % LOG_CODEC_WINDOW];
+                if (b != d[i + len]) break;
+                len++;
+            }
+            if (len > best_len) {
+                best_len = len;
+                best_dist = dist;
+            }
+        }
+
+        if (best_len >= MIN_MATCH) {
+            if (bits + REF_BITS > PAYLOAD_BITS) goto full;
+            put_bits(payload, &bits, 0, 1);
+            put_bits(payload, &bits, best_dist - 1, 8);
+            put_bits(payload, &bits, best_len - MIN_MATCH, 4);
+            i += best_len;
+        } else {
+            if (bits + LIT_BITS > PAYLOAD_BITS) goto full;
+            put_bits(payload, &bits, 1, 1);
+            put_bits(payload, &bits, d[i], 8);
+            i++;
+        }
+    }
+
+    for (uint32_t i = 0; i < LOG_REC_SIZE; i++) codec->window[(pos + i) % LOG_CODEC_WINDOW] = d[i];
+    codec->pos = pos + LOG_REC_SIZE;
+    codec->bits = bits;
+    codec->count++;
+    codec->prev = *rec;
+    return true;
+
+full:
+    // Desfaz os bits deste registro (o quadro começa zerado e só recebe OR)
+    if (codec->bits & 7) payload[codec->bits >> 3] &= (uint8_t)(0xFF00 >> (codec->bits & 7));
+    memset(&payload[(codec->bits + 7) >> 3], 0, ((bits + 7) >> 3) - ((codec->bits + 7) >> 3));
+    return false;
+}
+
+
+// Escreve o cabeçalho do quadro. Pode ser chamado a cada gravação parcial: o
+// quadro continua aberto para novos registros.
+void log_codec_finish(log_codec_t *codec) {
+    uint8_t *f = codec->frame;
+    uint16_t len = (uint16_t)((codec->bits + 7) >> 3);
+    f[0] = LOG_CODEC_MAGIC;
+    f[1] = 0;
+    put_u16(&f[2], codec->count);
+    put_u16(&f[4], len);
+    put_u16(&f[6], 0);
+    put_u16(&f[6], log_crc16(f, LOG_CODEC_HDR_SIZE + len));
+}
+
+
+// Decodifica um quadro, chamando emit (opcional) para cada registro em ordem.
+// Devolve o número de registros ou -1 se não for um quadro válido.
+int log_codec_decode(const uint8_t *frame, log_codec_emit_t emit, void *ctx) {
+    if (frame[0] != LOG_CODEC_MAGIC) return -1;
+    uint16_t count = get_u16(&frame[2]);
+    uint16_t len = get_u16(&frame[4]);
+    if (len > LOG_CODEC_FRAME_SIZE - LOG_CODEC_HDR_SIZE) return -1;
+
+    // CRC do cabeçalho (com o campo zerado) e do payload
+    uint8_t hdr[LOG_CODEC_HDR_SIZE];
+    memcpy(hdr, frame, sizeof(hdr));
+    put_u16(&hdr[6], 0);
+    uint16_t crc = log_crc16_update(log_crc16(hdr, sizeof(hdr)), frame + LOG_CODEC_HDR_SIZE, len);
+    if (crc != get_u16(&frame[6])) return -1;
+
+    const uint8_t *payload = frame + LOG_CODEC_HDR_SIZE;
+    uint32_t limit = (uint32_t)len * 8;
+    uint32_t bitpos = 0;
+    uint8_t window[LOG_CODEC_WINDOW];
+    uint32_t pos = 0;
+    uint8_t d[LOG_REC_SIZE];
+    log_record_t prev, rec;
+    memset(&prev, 0, sizeof(prev));
+
+    for (uint16_t n = 0; n < count;) {
+        int flag = get_bits(payload, &bitpos, limit, 1);
+        if (flag < 0) return -1;
+        if (flag) {
+            int lit = get_bits(payload, &bitpos, limit, 8);
+            if (lit < 0) return -1;
+            window[pos % LOG_CODEC_WINDOW] = (uint8_t)lit;
+            d[pos % LOG_REC_SIZE] = (uint8_t)lit;
+            pos++;
+        } else {
+            int dist = get_bits(payload, &bitpos, limit, 8);
+            int clen = get_bits(payload, &bitpos, limit, 4);
+            if (dist < 0 || clen < 0 || (uint32_t)dist + 1 > pos) return -1;
+            if (pos % LOG_REC_SIZE + (uint32_t)clen + MIN_MATCH > LOG_REC_SIZE) return -1; // cópias não atravessam registros
+            for (int k = 0; k < clen + MIN_MATCH; k++) {
+                uint8_t b = window[(pos - (uint32_t)dist - 1) % LOG_CODEC_WINDOW];
+                window[pos % LOG_CODEC_WINDOW] = b;
+                d[pos % LOG_REC_SIZE] = b;
+                pos++;
+            }
+        }
+        if (pos % LOG_REC_SIZE == 0) {
+            record_undelta(d, &prev, &rec);
+            if (emit) emit(&rec, ctx);
+            prev = rec;
+            n++;
+        }
+    }
+    return count;
+}
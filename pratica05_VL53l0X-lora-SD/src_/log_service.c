@@ -0,0 +1,115 @@
+#include "log_service.h"
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+#include "hardware/sync.h" // __dmb
+
+#if (LOG_SERVICE_RING_SIZE & (LOG_SERVICE_RING_SIZE - 1)) != 0
+#error "LOG_SERVICE_RING_SIZE deve ser potência de 2"
+#endif
+#if LOG_SERVICE_RING_SIZE < LOG_SERVICE_MAX_RATE_HZ * LOG_SERVICE_STALL_MS / 1000
+#error "LOG_SERVICE_RING_SIZE não cobre LOG_SERVICE_STALL_MS a LOG_SERVICE_MAX_RATE_HZ"
+#endif
+
+// Item do anel: registro pronto (com CRC) e se é um evento (f_sync pela política)
+typedef struct {
+    log_record_t rec;
+    bool event;
+} ring_entry_t;
+
+// Anel SPSC: head só é escrito pelo produtor (core0), tail só pelo consumidor
+// (core1). Índices livres (contam sem parar); a posição é índice & (SIZE - 1).
+static ring_entry_t ring[LOG_SERVICE_RING_SIZE];
+static volatile uint32_t head = 0;
+static volatile uint32_t tail = 0;
+
+static log_service_stats_t stats; // Cada campo tem um único core escritor
+static log_service_sink_t service_sink;
+static log_service_idle_t service_idle; // Opcional
+static log_t *service_log;
+static uint32_t core1_stack[LOG_SERVICE_STACK_WORDS];
+
+
+// Anota a maior parada do core1 desde t0 (o anel não é esvaziado enquanto isso)
+static void log_service_stall(uint64_t t0) {
+    uint32_t us = (uint32_t)(time_us_64() - t0);
+    if (us > stats.stall_max_us) stats.stall_max_us = us;
+}
+
+// Laço do core1: esvazia o anel; sem registros, aplica a política de tempo do log
+static void log_service_core1(void) {
+    for (;;) {
+        uint32_t t = tail;
+        uint64_t t0 = time_us_64();
+        if (t == head) {
+            if (service_idle) service_idle();
+            log_poll(service_log); // FR_NOT_ENABLED se a sessão não abriu: ignorado
+            log_service_stall(t0);
+            sleep_us(LOG_SERVICE_IDLE_US);
+            continue;
+        }
+        __dmb(); // lê o item só depois de ver o head que o publicou
+
+        const ring_entry_t *e = &ring[t & (LOG_SERVICE_RING_SIZE - 1)];
+        if (service_sink(&e->rec, e->event) == FR_OK) stats.written++;
+        else stats.errors++;
+        log_service_stall(t0);
+
+        __dmb(); // item consumido antes de liberar a posição ao produtor
+        tail = t + 1;
+    }
+}
+
+
+// Inicia o serviço no core1 (uma vez, depois de abrir o log no core0)
+void log_service_start(log_service_sink_t sink, log_t *log) {
+    service_sink = sink;
+    service_log = log;
+    multicore_launch_core1_with_stack(log_service_core1, core1_stack, sizeof(core1_stack));
+}
+
+
+// Define o trabalho do core1 com o anel vazio (antes de log_service_start)
+void log_service_set_idle(log_service_idle_t idle) {
+    service_idle = idle;
+}
+
+
+// Enfileira um registro (core0). Nunca bloqueia: com o anel cheio o registro é
+// descartado e contado em dropped.
+bool log_service_push(const log_record_t *rec, bool event) {
+    uint32_t h = head;
+    uint32_t used = h - tail;
+    if (used >= LOG_SERVICE_RING_SIZE) {
+        stats.dropped++;
+        return false;
+    }
+
+    ring_entry_t *e = &ring[h & (LOG_SERVICE_RING_SIZE - 1)];
+    e->rec = *rec;
+    e->event = event;
+    __dmb(); // item completo antes de publicar o novo head
+    head = h + 1;
+
+    stats.pushed++;
+    if (used + 1 > stats.high_watermark) stats.high_watermark = used + 1;
+    return true;
+}
+
+
+// Registros ainda no anel
+uint32_t log_service_pending(void) {
+    return head - tail;
+}
+
+void log_service_get_stats(log_service_stats_t *out) {
+    *out = stats;
+}
+
+void log_service_dump(void) {
+    printf("\nServiço de log (core1): %lu enfileirados, %lu gravados, %lu descartados, %lu erros, "
+           "pico do anel %lu/%u, pendentes %lu, parada máx. %lu us (prevista %u ms)\n",
+           (unsigned long)stats.pushed, (unsigned long)stats.written, (unsigned long)stats.dropped,
+           (unsigned long)stats.errors, (unsigned long)stats.high_watermark, LOG_SERVICE_RING_SIZE,
+           (unsigned long)log_service_pending(), (unsigned long)stats.stall_max_us, LOG_SERVICE_STALL_MS);
+}